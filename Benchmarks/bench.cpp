@@ -0,0 +1,626 @@
+#include <raylib-ext.hpp>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "alloc_counter.hpp"
+#include "board.hpp"
+#include "chunked_board.hpp"
+#include "frame_arena.hpp"
+#include "frame_cache.hpp"
+#include "harness.hpp"
+#include "indexed_render.hpp"
+#include "jobs.hpp"
+#include "post_process.hpp"
+#include "raycast.hpp"
+#include "render.hpp"
+#include "scene.hpp"
+#include "simd.hpp"
+#include "visibility.hpp"
+#include "world.hpp"
+
+const char *textures_dir = "./Assets/textures";
+const int view_width = 256;
+const int view_height = 768;
+const float view_fov = 75 * DEG2RAD;
+const int view_span = 16;
+
+Scene
+make_scene(SceneKind kind, int size, size_t sprites,
+           BoardBackend backend = BoardBackend::Dense,
+           const std::vector<Image> &images = {})
+{
+    SceneParams params;
+    params.kind = kind;
+    params.seed = 42;
+    params.width = params.height = size;
+    params.sprites = sprites;
+    params.backend = backend;
+    return generate_scene(params, images);
+}
+
+std::string
+scene_label(SceneKind kind, int size)
+{
+    return std::string(scene_kind_name(kind)) + "-" + std::to_string(size);
+}
+
+// random empty-cell origins and directions, fixed seed
+void
+random_rays(const Board &board, size_t count,
+            std::vector<Vector2> &origins, std::vector<Vector2> &dirs)
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> cx(1, board.width() - 2);
+    std::uniform_int_distribution<int> cy(1, board.height() - 2);
+    std::uniform_real_distribution<float> angle(-PI, PI);
+    origins.clear();
+    dirs.clear();
+    while (origins.size() < count)
+    {
+        CellPos cell(cx(rng), cy(rng));
+        if (board.at(cell) != 0)
+            continue;
+        origins.push_back({ (cell.x + 0.5f) * cell_size, (cell.y + 0.5f) * cell_size });
+        float a = angle(rng);
+        dirs.push_back({ std::cos(a), std::sin(a) });
+    }
+}
+
+void
+bench_boards(BenchRunner &runner, int size)
+{
+    for (SceneKind kind : { SceneKind::Arena, SceneKind::Maze })
+    {
+        for (BoardBackend backend : { BoardBackend::Dense, BoardBackend::Quadtree,
+                                      BoardBackend::Chunked })
+        {
+            std::string prefix = std::string("board/") + board_backend_name(backend) +
+                                 "/" + scene_label(kind, size);
+            if (!runner.enabled(prefix))
+                continue;
+
+            Scene scene = make_scene(kind, size, 0, backend);
+            const Board &board = *scene.board;
+            std::vector<Vector2> origins, dirs;
+            random_rays(board, 4096, origins, dirs);
+
+            runner.run(prefix + "/at", [&](size_t i) {
+                CellPos cell(origins[i % 4096] / cell_size);
+                bench_sink = bench_sink + board.at(cell);
+            });
+            runner.counter("memory_bytes", board.memory_footprint());
+            runner.run(prefix + "/cast_ray", [&](size_t i) {
+                RayHit hit = cast_ray(board, origins[i % 4096], dirs[i % 4096]);
+                bench_sink = bench_sink + hit.cell_pos.x;
+            });
+        }
+    }
+}
+
+// Walks the focus across a world far larger than the budget
+void
+bench_streaming(BenchRunner &runner)
+{
+    if (!runner.enabled("board/chunked/streaming"))
+        return;
+
+    ChunkedBoardConfig config;
+    config.memory_budget = 4u << 20;
+    config.load_radius = 3;
+    ChunkedBoard board(config, [](int x, int y) {
+        return (x % 7 == 0 && y % 5 == 0) ? 1 : 0;
+    });
+
+    size_t peak = 0;
+    Vector2 focus = { 100.5f * cell_size, 100.5f * cell_size };
+    runner.run("board/chunked/streaming", [&](size_t i) {
+        focus.x += 16 * cell_size;
+        board.stream(focus);
+        float a = (i % 64) * 2 * PI / 64;
+        RayHit hit = cast_ray(board, focus, { std::cos(a), std::sin(a) });
+        bench_sink = bench_sink + hit.cell_pos.x;
+        peak = std::max(peak, board.memory_footprint());
+    });
+    runner.counter("peak_resident_bytes", peak);
+    runner.counter("budget_bytes", config.memory_budget);
+}
+
+void
+bench_cast_ray(BenchRunner &runner)
+{
+    for (SceneKind kind : { SceneKind::Maze, SceneKind::Arena, SceneKind::Corridors })
+    {
+        std::string label = scene_label(kind, 128);
+        if (!runner.enabled("cast_ray/random/" + label) &&
+            !runner.enabled("cast_ray/coherent/" + label) &&
+            !runner.enabled("cast_view/" + label) &&
+            !runner.enabled("cast_view/spans/" + label) &&
+            !runner.enabled("cast_view/segments/" + label))
+            continue;
+
+        Scene scene = make_scene(kind, 128, 0);
+        std::vector<Vector2> origins, dirs;
+        random_rays(*scene.board, 4096, origins, dirs);
+
+        runner.run("cast_ray/random/" + label, [&](size_t i) {
+            RayHit hit = cast_ray(*scene.board, origins[i % 4096], dirs[i % 4096]);
+            bench_sink = bench_sink + hit.cell_pos.x;
+        });
+
+        // neighbouring rays of one view, as the renderer issues them
+        Player player = scene.player;
+        runner.run("cast_ray/coherent/" + label, [&](size_t i) {
+            float angle = player.rotation - view_fov / 2 + (i % view_width) * view_fov / view_width;
+            RayHit hit = cast_ray(*scene.board, player.pos, { std::cos(angle), std::sin(angle) });
+            bench_sink = bench_sink + hit.cell_pos.x;
+        });
+
+        // a whole view, rays generated from the camera plane
+        ColumnBuffer columns;
+        runner.run("cast_view/" + label, [&](size_t i) {
+            player.rotation = scene.player.rotation + (i % 64) * 2 * PI / 64;
+            cast_view(*scene.board, player, view_fov, view_width, columns);
+            bench_sink = bench_sink + columns.cell[0].x;
+        });
+
+        // rays only at wall span edges
+        long rays = 0, views = 0;
+        runner.run("cast_view/spans/" + label, [&](size_t i) {
+            player.rotation = scene.player.rotation + (i % 64) * 2 * PI / 64;
+            cast_view(*scene.board, player, view_fov, view_width, columns, view_span);
+            bench_sink = bench_sink + columns.cell[0].x;
+            rays += columns.rays_cast;
+            views++;
+        });
+        if (views > 0)
+            runner.counter("rays_per_view", double(rays) / views);
+
+        // no rays at all, visible faces from a front to back cell walk
+        runner.run("cast_view/segments/" + label, [&](size_t i) {
+            player.rotation = scene.player.rotation + (i % 64) * 2 * PI / 64;
+            extract_view(*scene.board, player, view_fov, view_width, columns);
+            bench_sink = bench_sink + columns.cell[0].x;
+        });
+    }
+}
+
+void
+bench_render_kernels(BenchRunner &runner, const RenderAssets &assets,
+                     const std::vector<Image> &sprite_images)
+{
+    Framebuffer fb;
+    fb.resize(view_width, view_height);
+    RenderSettings settings;
+    settings.fov = view_fov;
+
+    // walls from far (short columns) to near (clipped full height columns)
+    const float dists[] = { 400.0f, 120.0f, 40.0f };
+    for (float dist : dists)
+    {
+        runner.run("render/wall_column/dist-" + std::to_string(int(dist)), [&](size_t i) {
+            draw_wall_column(fb, i % fb.width, dist, assets.walls[1],
+                             i % assets.walls[1].width, settings);
+        });
+    }
+
+    Scene scene = make_scene(SceneKind::Arena, 64, 0);
+    ColumnBuffer columns;
+    cast_view(*scene.board, scene.player, settings.fov, fb.width, columns);
+
+    runner.run("render/floor", [&](size_t) {
+        render_floor(fb, columns, assets, settings);
+    });
+    runner.run("render/walls", [&](size_t) {
+        render_walls(fb, columns, assets, settings);
+    });
+
+    // the same floor and walls through other kernel instantiations
+    for (RenderFeature feature : { RENDER_SHADING, RENDER_FOG, RENDER_DEBUG })
+    {
+        RenderSettings featured = settings;
+        featured.features |= feature;
+        std::string name = std::string("render/floor_walls/") + render_feature_name(feature);
+        runner.run(name, [&](size_t) {
+            render_floor(fb, columns, assets, featured);
+            render_walls(fb, columns, assets, featured);
+        });
+    }
+
+    for (size_t count : { 10, 1000, 100000 })
+    {
+        std::string name = "render/sprites/" + std::to_string(count);
+        if (!runner.enabled(name))
+            continue;
+        Scene sprites = make_scene(SceneKind::Arena, 256, count,
+                                   BoardBackend::Dense, sprite_images);
+        ColumnBuffer sprite_columns;
+        cast_view(*sprites.board, sprites.player, settings.fov, fb.width, sprite_columns);
+        render_walls(fb, sprite_columns, assets, settings);
+        runner.run(name, [&](size_t) {
+            render_sprites(fb, sprites.player, sprite_columns, sprites.objects, settings);
+        });
+    }
+}
+
+// The same view at one byte per pixel, and expanding it back to colours
+void
+bench_indexed(BenchRunner &runner, const RenderAssets &assets,
+              const std::vector<Image> &sprite_images)
+{
+    IndexedAssets indexed = index_render_assets(assets, sprite_images);
+    IndexedFramebuffer fb;
+    fb.resize(view_width, view_height);
+    Framebuffer out;
+    out.resize(view_width, view_height);
+    RenderSettings settings;
+    settings.fov = view_fov;
+    Colormap colormap;
+
+    Scene scene = make_scene(SceneKind::Arena, 128, 100, BoardBackend::Dense, sprite_images);
+    ColumnBuffer columns;
+    cast_view(*scene.board, scene.player, settings.fov, fb.width, columns, view_span);
+    for (uint8_t features : { uint8_t(0), uint8_t(RENDER_SHADING | RENDER_FOG) })
+    {
+        settings.features = features;
+        colormap.update(indexed.palette, settings);
+        runner.run(std::string("indexed/frame/") + (features ? "shading_fog" : "plain"),
+                   [&](size_t) {
+            render_view_indexed(fb, scene.player, columns, scene.objects, indexed, colormap,
+                                settings);
+        });
+    }
+
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::AVX2 })
+    {
+        simd_limit(level);
+        runner.run(std::string("indexed/expand/") + simd_level_name(simd_level()), [&](size_t) {
+            expand_framebuffer(fb, indexed.palette, out);
+        });
+    }
+    simd_limit(SimdLevel::AVX2);
+}
+
+// Each post pass, then all of them from 256x192 up to 1024x768, per
+// instruction set
+void
+bench_post_process(BenchRunner &runner)
+{
+    Framebuffer src;
+    src.resize(256, 192);
+    std::mt19937 rng(42);
+    for (Color &pixel : src.pixels)
+        pixel = Color { uint8_t(rng()), uint8_t(rng()), uint8_t(rng()), 255 };
+    Framebuffer dst;
+    PostSettings settings;
+    settings.tint = Color { 255, 0, 0, 64 };
+    settings.lut.build(1.2f, 0.05f);
+    settings.scale_x = settings.scale_y = 4;
+    std::vector<Color> row(1024);
+
+    runner.run("post/lut", [&](size_t) {
+        apply_lut(row.data(), row.size(), settings.lut);
+    });
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 })
+    {
+        simd_limit(level);
+        if (simd_level() != level)
+            continue;
+        std::string suffix = std::string("/") + simd_level_name(level);
+        runner.run("post/tint" + suffix, [&](size_t) {
+            tint_pixels(row.data(), row.size(), settings.tint);
+        });
+        runner.run("post/upscale-4" + suffix, [&](size_t) {
+            upscale_row(src.pixels.data(), 256, 4, row.data());
+        });
+        runner.run("post/frame/256x192-x4" + suffix, [&](size_t) {
+            post_process(src, settings, dst);
+        });
+    }
+    simd_limit(SimdLevel::AVX2);
+}
+
+// Column fills against both pixel orders, and what presenting a column
+// order frame costs
+void
+bench_pixel_order(BenchRunner &runner, const RenderAssets &assets,
+                  const std::vector<Image> &sprite_images)
+{
+    RenderSettings settings;
+    settings.fov = view_fov;
+    Scene scene = make_scene(SceneKind::Arena, 128, 100, BoardBackend::Dense, sprite_images);
+    ColumnBuffer columns;
+    cast_view(*scene.board, scene.player, settings.fov, view_width, columns, view_span);
+
+    for (PixelOrder order : { PixelOrder::Rows, PixelOrder::Columns })
+    {
+        Framebuffer fb;
+        fb.order = order;
+        fb.resize(view_width, view_height);
+        Framebuffer out;
+        std::string suffix = order == PixelOrder::Rows ? "/rows" : "/columns";
+
+        runner.run("order/wall_column/dist-40" + suffix, [&](size_t i) {
+            draw_wall_column(fb, i % fb.width, 40.0f, assets.walls[1],
+                             i % assets.walls[1].width, settings);
+        });
+        runner.run("order/walls" + suffix, [&](size_t) {
+            render_walls(fb, columns, assets, settings);
+        });
+        runner.run("order/floor" + suffix, [&](size_t) {
+            render_floor(fb, columns, assets, settings);
+        });
+        runner.run("order/frame" + suffix, [&](size_t) {
+            render_view(fb, scene.player, columns, scene.objects, assets, settings);
+        });
+        // the copy into rows, transposed for column order
+        runner.run("order/present" + suffix, [&](size_t) {
+            post_process(fb, PostSettings {}, out);
+        });
+    }
+
+    Framebuffer fb;
+    fb.order = PixelOrder::Columns;
+    fb.resize(view_width, view_height);
+    std::vector<Color> rows(fb.pixels.size());
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 })
+    {
+        simd_limit(level);
+        if (simd_level() != level)
+            continue;
+        runner.run(std::string("order/transpose/") + simd_level_name(level), [&](size_t) {
+            transpose_pixels(fb.pixels.data(), fb.height, fb.width, fb.height,
+                             rows.data(), fb.width);
+        });
+    }
+    simd_limit(SimdLevel::AVX2);
+}
+
+void
+bench_world_queries(BenchRunner &runner)
+{
+    Scene scene = make_scene(SceneKind::Maze, 64, 0);
+    std::vector<Vector2> origins, dirs;
+    random_rays(*scene.board, 256, origins, dirs);
+
+    std::vector<CellPos> path;
+    runner.run("find_path/" + scene_label(SceneKind::Maze, 64), [&](size_t i) {
+        find_path(*scene.board, origins[i % 256], origins[(i + 1) % 256], path);
+        bench_sink = bench_sink + path.size();
+    });
+    runner.run("find_collisions/" + scene_label(SceneKind::Maze, 64), [&](size_t i) {
+        Vector2 pos = origins[i % 256] + dirs[i % 256] * (cell_size * 0.45f);
+        ArenaScope scope;
+        auto collisions = find_collisions(*scene.board, pos, 25);
+        bench_sink = bench_sink + collisions.size();
+    });
+}
+
+void
+bench_frames(BenchRunner &runner, const RenderAssets &assets,
+             const std::vector<Image> &sprite_images)
+{
+    Framebuffer fb;
+    fb.resize(view_width, view_height);
+    RenderSettings settings;
+    settings.fov = view_fov;
+    ColumnBuffer columns;
+
+    const SceneKind kinds[] = { SceneKind::Room, SceneKind::Maze, SceneKind::Arena,
+                                SceneKind::Corridors, SceneKind::Pillars };
+    for (SceneKind kind : kinds)
+    {
+        for (size_t sprites : { 10, 1000 })
+        {
+            if (kind == SceneKind::Room && sprites != 10)
+                continue;
+            std::string name = "frame/" + scene_label(kind, 128) + "/" +
+                               std::to_string(sprites);
+            if (!runner.enabled(name))
+                continue;
+
+            Scene scene = make_scene(kind, 128, sprites, BoardBackend::Dense,
+                                     sprite_images);
+            runner.run(name, [&](size_t i) {
+                Player player = scene.player;
+                player.rotation += (i % 64) * 2 * PI / 64;
+                cast_view(*scene.board, player, settings.fov, fb.width, columns, view_span);
+                render_view(fb, player, columns, scene.objects, assets, settings);
+            });
+        }
+    }
+
+    // frames the cache can reuse: a still view, then only sprites moving
+    std::string label = scene_label(SceneKind::Arena, 128);
+    if (!runner.enabled("frame_cache/" + label + "/still") &&
+        !runner.enabled("frame_cache/" + label + "/sprites"))
+        return;
+    Scene scene = make_scene(SceneKind::Arena, 128, 10, BoardBackend::Dense, sprite_images);
+    FrameCache cache;
+    auto cached_frame = [&]() {
+        if (cache.view_changed(*scene.board, scene.board->revision(), scene.player,
+                               settings.fov, fb, settings))
+            cast_view(*scene.board, scene.player, settings.fov, fb.width, columns, view_span);
+        return cache.render(fb, scene.player, columns, scene.objects, assets, settings);
+    };
+    runner.run("frame_cache/" + label + "/still", [&](size_t) {
+        bench_sink = bench_sink + int(cached_frame());
+    });
+    runner.run("frame_cache/" + label + "/sprites", [&](size_t i) {
+        for (Object &object : scene.objects)
+            object.pos.x += (i % 2 ? -1.0f : 1.0f);
+        bench_sink = bench_sink + int(cached_frame());
+    });
+}
+
+// The same frames and path searches on 1 to max_threads threads
+void
+bench_job_scaling(BenchRunner &runner, const RenderAssets &assets,
+                  const std::vector<Image> &sprite_images, int max_threads)
+{
+    std::string frame_label = scene_label(SceneKind::Arena, 128);
+    std::string path_label = scene_label(SceneKind::Maze, 64);
+    Scene scene = make_scene(SceneKind::Arena, 128, 100, BoardBackend::Dense, sprite_images);
+    Scene maze = make_scene(SceneKind::Maze, 64, 0);
+    std::vector<Vector2> origins, dirs;
+    random_rays(*maze.board, 256, origins, dirs);
+
+    Framebuffer fb;
+    fb.resize(view_width, view_height);
+    RenderSettings settings;
+    settings.fov = view_fov;
+    ColumnBuffer columns;
+
+    // one search per agent, as the simulation issues them every step
+    const int agents = 16;
+    std::vector<std::vector<CellPos>> paths(agents);
+
+    for (int threads = 1; threads <= max_threads; threads++)
+    {
+        std::string suffix = "/threads-" + std::to_string(threads);
+        if (!runner.enabled("jobs/frame/" + frame_label + suffix) &&
+            !runner.enabled("jobs/find_path/" + path_label + suffix))
+            continue;
+        jobs.start(threads);
+
+        runner.run("jobs/frame/" + frame_label + suffix, [&](size_t i) {
+            Player player = scene.player;
+            player.rotation += (i % 64) * 2 * PI / 64;
+            cast_view(*scene.board, player, settings.fov, fb.width, columns, view_span);
+            render_view(fb, player, columns, scene.objects, assets, settings);
+        });
+
+        runner.run("jobs/find_path/" + path_label + suffix, [&](size_t i) {
+            auto search = [&](int agent, int) {
+                find_path(*maze.board, origins[(i + agent) % 256], origins[(i + 1) % 256],
+                          paths[agent]);
+            };
+            JobCounter counter;
+            for (int agent = 0; agent < agents; agent++)
+                jobs.run(counter, search, agent, agent + 1);
+            jobs.wait(counter);
+            bench_sink = bench_sink + paths[0].size();
+        });
+    }
+    jobs.stop();
+}
+
+// The frame main() runs, past the warm up, on a job system with workers so
+// the calling thread runs jobs inside wait() as well. Fails if any of it
+// allocates on this thread; only builds that count allocations can tell.
+bool
+check_frame_allocations(const BenchRunner &runner, const RenderAssets &assets,
+                        const std::vector<Image> &sprite_images, int threads)
+{
+    const std::string name = "alloc/steady-frame";
+    if (!ALLOC_COUNTER_ENABLED || !runner.enabled(name))
+        return true;
+
+    Scene scene = make_scene(SceneKind::Arena, 128, 100, BoardBackend::Dense, sprite_images);
+    Framebuffer fb;
+    fb.resize(view_width, view_height);
+    Framebuffer out;
+    RenderSettings settings;
+    settings.fov = view_fov;
+    PostSettings post;
+    post.tint = Color { 255, 200, 100, 64 };
+    post.scale_x = post.scale_y = 2;
+    ColumnBuffer columns;
+    FrameCache cache;
+
+    jobs.start(std::max(threads, 2));
+    const int warmup_frames = 10;
+    uint64_t allocations = 0;
+    for (int i = 0; i < warmup_frames + 100; i++)
+    {
+        ArenaScope frame_scope;
+        uint64_t start = thread_allocation_count();
+        // turning every other frame, sprites moving on the others
+        if (i % 2)
+            scene.player.rotation += 2 * PI / 64;
+        for (Object &object : scene.objects)
+            object.pos.x += (i % 4 < 2 ? -1.0f : 1.0f);
+        if (cache.view_changed(*scene.board, scene.board->revision(), scene.player,
+                               settings.fov, fb, settings))
+            cast_view(*scene.board, scene.player, settings.fov, fb.width, columns, view_span);
+        cache.render(fb, scene.player, columns, scene.objects, assets, settings);
+        post_process(fb, post, out);
+        if (i >= warmup_frames)
+            allocations += thread_allocation_count() - start;
+    }
+    jobs.stop();
+
+    std::cout << name << ": " << allocations << " allocations in 100 frames" << std::endl;
+    return allocations == 0;
+}
+
+void
+usage()
+{
+    std::cerr << "usage: raycaster-bench [--filter TEXT] [--min-time SEC]"
+                 " [--repetitions N] [--json FILE] [--csv FILE]"
+                 " [--baseline FILE.csv] [--threshold PERCENT]"
+                 " [--board-size N] [--threads N]" << std::endl;
+}
+
+int
+main(int argc, char **argv)
+{
+    BenchOptions options;
+    int board_size = 2048;
+    int max_threads = std::max(int(std::thread::hardware_concurrency()), 1);
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--filter" && has_value)
+            options.filter = argv[++i];
+        else if (arg == "--min-time" && has_value)
+            options.min_time = std::stod(argv[++i]);
+        else if (arg == "--repetitions" && has_value)
+            options.repetitions = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--json" && has_value)
+            options.json_path = argv[++i];
+        else if (arg == "--csv" && has_value)
+            options.csv_path = argv[++i];
+        else if (arg == "--baseline" && has_value)
+            options.baseline_path = argv[++i];
+        else if (arg == "--threshold" && has_value)
+            options.threshold = std::stod(argv[++i]);
+        else if (arg == "--board-size" && has_value)
+            board_size = std::stoi(argv[++i]);
+        else if (arg == "--threads" && has_value)
+            max_threads = std::max(std::stoi(argv[++i]), 1);
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+    RenderAssets assets = load_render_assets(textures_dir);
+    std::vector<Image> sprite_images = {
+        LoadImage(std::string(textures_dir) + "/barrel.png"),
+        LoadImage(std::string(textures_dir) + "/enemy1.png"),
+    };
+
+    BenchRunner runner(options);
+    bench_boards(runner, board_size);
+    bench_streaming(runner);
+    bench_cast_ray(runner);
+    bench_render_kernels(runner, assets, sprite_images);
+    bench_indexed(runner, assets, sprite_images);
+    bench_post_process(runner);
+    bench_pixel_order(runner, assets, sprite_images);
+    bench_world_queries(runner);
+    bench_frames(runner, assets, sprite_images);
+    bench_job_scaling(runner, assets, sprite_images, max_threads);
+    bool no_allocations = check_frame_allocations(runner, assets, sprite_images, max_threads);
+    return runner.finish() && no_allocations ? 0 : 1;
+}
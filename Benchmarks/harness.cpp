@@ -0,0 +1,169 @@
+#include "harness.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+volatile long bench_sink;
+
+BenchRunner::BenchRunner(const BenchOptions &options)
+    : options(options)
+{
+    std::cout << std::left << std::setw(40) << "benchmark"
+              << std::right << std::setw(16) << "ns/op"
+              << std::setw(12) << "iterations" << std::endl;
+}
+
+bool
+BenchRunner::enabled(const std::string &name) const
+{
+    return options.filter.empty() || name.find(options.filter) != std::string::npos;
+}
+
+void
+BenchRunner::record(const std::string &name, std::vector<double> samples,
+                    size_t iterations)
+{
+    std::sort(samples.begin(), samples.end());
+    double median = samples[samples.size() / 2];
+    results.push_back(BenchResult { name, median, iterations, {} });
+
+    std::cout << std::left << std::setw(40) << name
+              << std::right << std::fixed << std::setprecision(1)
+              << std::setw(16) << median
+              << std::setw(12) << iterations << std::endl;
+}
+
+void
+BenchRunner::counter(const std::string &key, double value)
+{
+    if (results.empty())
+        return;
+    results.back().counters.emplace_back(key, value);
+    std::cout << "    " << key << " = " << std::fixed << std::setprecision(1)
+              << value << std::endl;
+}
+
+static std::string
+json_escape(const std::string &s)
+{
+    std::string out;
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+static void
+write_json(const std::string &path, const std::vector<BenchResult> &results)
+{
+    std::ofstream out(path);
+    out << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult &r = results[i];
+        out << "    { \"name\": \"" << json_escape(r.name) << "\""
+            << ", \"ns_per_op\": " << std::setprecision(10) << r.ns_per_op
+            << ", \"iterations\": " << r.iterations;
+        if (!r.counters.empty())
+        {
+            out << ", \"counters\": {";
+            for (size_t k = 0; k < r.counters.size(); k++)
+            {
+                out << (k ? ", " : " ") << "\"" << json_escape(r.counters[k].first)
+                    << "\": " << r.counters[k].second;
+            }
+            out << " }";
+        }
+        out << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+// name,ns_per_op,iterations followed by key=value counters
+static void
+write_csv(const std::string &path, const std::vector<BenchResult> &results)
+{
+    std::ofstream out(path);
+    out << "name,ns_per_op,iterations,counters\n";
+    for (auto &r : results)
+    {
+        out << r.name << "," << std::setprecision(10) << r.ns_per_op << ","
+            << r.iterations << ",";
+        for (size_t k = 0; k < r.counters.size(); k++)
+            out << (k ? ";" : "") << r.counters[k].first << "=" << r.counters[k].second;
+        out << "\n";
+    }
+}
+
+static bool
+read_baseline(const std::string &path, std::map<std::string, double> &baseline)
+{
+    std::ifstream in(path);
+    if (!in)
+        return false;
+    std::string line;
+    std::getline(in, line); // header
+    for (int number = 2; std::getline(in, line); number++)
+    {
+        if (line.empty())
+            continue;
+        std::istringstream fields(line);
+        std::string name, ns;
+        char *end = nullptr;
+        double value = 0;
+        if (std::getline(fields, name, ',') && std::getline(fields, ns, ','))
+            value = std::strtod(ns.c_str(), &end);
+        // hand edited or truncated files lose the line, not the run
+        if (!end || end == ns.c_str() || *end != '\0' || !std::isfinite(value) || value <= 0)
+        {
+            std::cerr << path << ":" << number << ": skipping malformed line" << std::endl;
+            continue;
+        }
+        baseline[name] = value;
+    }
+    return true;
+}
+
+bool
+BenchRunner::finish()
+{
+    if (!options.json_path.empty())
+        write_json(options.json_path, results);
+    if (!options.csv_path.empty())
+        write_csv(options.csv_path, results);
+    if (options.baseline_path.empty())
+        return true;
+
+    std::map<std::string, double> baseline;
+    if (!read_baseline(options.baseline_path, baseline))
+    {
+        std::cerr << "can't read baseline " << options.baseline_path << std::endl;
+        return false;
+    }
+
+    bool ok = true;
+    std::cout << "\ncompared to " << options.baseline_path
+              << " (threshold " << options.threshold << "%)" << std::endl;
+    for (auto &r : results)
+    {
+        auto it = baseline.find(r.name);
+        if (it == baseline.end())
+            continue;
+        double change = (r.ns_per_op / it->second - 1) * 100;
+        bool regressed = change > options.threshold;
+        ok = ok && !regressed;
+        std::cout << std::left << std::setw(40) << r.name
+                  << std::right << std::showpos << std::fixed << std::setprecision(1)
+                  << std::setw(10) << change << "%" << std::noshowpos
+                  << (regressed ? "  REGRESSION" : "") << std::endl;
+    }
+    return ok;
+}
@@ -0,0 +1,93 @@
+#ifndef HARNESS_HPP
+#define HARNESS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct BenchResult {
+    std::string name;
+    double ns_per_op;
+    size_t iterations;
+    std::vector<std::pair<std::string, double>> counters;
+};
+
+struct BenchOptions {
+    std::string filter;
+    double min_time = 0.05;   // seconds per repetition
+    int repetitions = 5;
+    std::string json_path;
+    std::string csv_path;
+    std::string baseline_path;
+    double threshold = 10.0;  // percent slower than the baseline that fails
+};
+
+// keeps the optimizer from dropping the measured calls
+extern volatile long bench_sink;
+
+class BenchRunner
+{
+public:
+    explicit BenchRunner(const BenchOptions &options);
+
+    bool enabled(const std::string &name) const;
+
+    // Times op(i) for i = 0, 1, ... and records the median ns per call of
+    // several repetitions, each long enough to hide the clock resolution.
+    template <typename F>
+    void run(const std::string &name, F &&op);
+
+    // Attaches a named value (bytes, counts) to the last result
+    void counter(const std::string &key, double value);
+
+    // Writes the requested reports and compares against the baseline.
+    // Returns false if anything regressed past the threshold.
+    bool finish();
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    void record(const std::string &name, std::vector<double> samples,
+                size_t iterations);
+
+    BenchOptions options;
+    std::vector<BenchResult> results;
+};
+
+template <typename F>
+void
+BenchRunner::run(const std::string &name, F &&op)
+{
+    if (!enabled(name))
+        return;
+
+    // warm up and find a batch size that runs for min_time
+    size_t index = 0;
+    size_t batch = 1;
+    for (;;)
+    {
+        auto start = clock::now();
+        for (size_t i = 0; i < batch; i++)
+            op(index++);
+        double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        if (elapsed >= options.min_time)
+            break;
+        batch = elapsed > 0 ? size_t(batch * 1.5 * options.min_time / elapsed) + 1
+                            : batch * 10;
+    }
+
+    std::vector<double> samples;
+    for (int r = 0; r < options.repetitions; r++)
+    {
+        auto start = clock::now();
+        for (size_t i = 0; i < batch; i++)
+            op(index++);
+        double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        samples.push_back(ns / batch);
+    }
+    record(name, std::move(samples), batch * options.repetitions);
+}
+
+#endif // HARNESS_HPP
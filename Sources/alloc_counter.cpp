@@ -0,0 +1,63 @@
+#include "alloc_counter.hpp"
+#include <cstdlib>
+#include <new>
+
+static thread_local uint64_t allocations = 0;
+
+uint64_t
+thread_allocation_count()
+{
+    return allocations;
+}
+
+AllowAllocations::AllowAllocations() : count(allocations)
+{
+}
+
+AllowAllocations::~AllowAllocations()
+{
+    allocations = count;
+}
+
+#if ALLOC_COUNTER_ENABLED
+
+void *
+operator new(size_t size)
+{
+    allocations++;
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *
+operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void
+operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete(void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete[](void *p, size_t) noexcept
+{
+    std::free(p);
+}
+
+#endif
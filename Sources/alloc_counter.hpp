@@ -0,0 +1,33 @@
+#ifndef ALLOC_COUNTER_HPP
+#define ALLOC_COUNTER_HPP
+
+#include <cstdint>
+
+// Debug builds, and any build configured with COUNT_ALLOCATIONS, replace the
+// global operator new to count allocations made by the calling thread;
+// otherwise the count stays 0.
+#if !defined(NDEBUG) || defined(COUNT_ALLOCATIONS)
+#define ALLOC_COUNTER_ENABLED 1
+#else
+#define ALLOC_COUNTER_ENABLED 0
+#endif
+
+uint64_t
+thread_allocation_count();
+
+// Allocations inside the scope aren't counted, for work that allocates by
+// design (chunk requests, writing a trace)
+class AllowAllocations
+{
+public:
+    AllowAllocations();
+    ~AllowAllocations();
+
+    AllowAllocations(const AllowAllocations &) = delete;
+    AllowAllocations &operator=(const AllowAllocations &) = delete;
+
+private:
+    uint64_t count;
+};
+
+#endif // ALLOC_COUNTER_HPP
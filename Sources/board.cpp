@@ -0,0 +1,260 @@
+#include "board.hpp"
+#include "chunked_board.hpp"
+#include <algorithm>
+
+/* DenseBoard */
+
+DenseBoard::DenseBoard(int w, int h)
+    : w(w), h(h), cells(size_t(w) * h, 0)
+{
+}
+
+DenseBoard::DenseBoard(int w, int h, const CellSource &source)
+    : DenseBoard(w, h)
+{
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x)
+            cells[size_t(y) * w + x] = source(x, y);
+}
+
+int
+DenseBoard::at(int x, int y) const
+{
+    return cells[size_t(y) * w + x];
+}
+
+void
+DenseBoard::set(int x, int y, int value)
+{
+    uint8_t &cell = cells[size_t(y) * w + x];
+    if (cell == value)
+        return;
+    cell = value;
+    touch();
+}
+
+BoardNode
+DenseBoard::node(int x, int y) const
+{
+    return BoardNode { at(x, y), CellPos(x, y), CellPos(x + 1, y + 1) };
+}
+
+size_t
+DenseBoard::memory_footprint() const
+{
+    return cells.capacity() * sizeof(cells[0]);
+}
+
+/* QuadtreeBoard */
+
+static int
+quadtree_size(int w, int h)
+{
+    int size = 1;
+    while (size < w || size < h)
+        size *= 2;
+    return size;
+}
+
+QuadtreeBoard::QuadtreeBoard(int w, int h)
+    : w(w), h(h), size(quadtree_size(w, h)), root { -1, 0 }
+{
+}
+
+QuadtreeBoard::QuadtreeBoard(int w, int h, const CellSource &source)
+    : QuadtreeBoard(w, h)
+{
+    root = build(source, 0, 0, size);
+}
+
+QuadtreeBoard::Node
+QuadtreeBoard::build(const CellSource &source, int x0, int y0, int size)
+{
+    // cells past the board edge are never queried, treat them as empty
+    if (x0 >= w || y0 >= h)
+        return Node { -1, 0 };
+    if (size == 1)
+        return Node { -1, uint8_t(source(x0, y0)) };
+
+    int half = size / 2;
+    Node children[4] = {
+        build(source, x0,        y0,        half),
+        build(source, x0 + half, y0,        half),
+        build(source, x0,        y0 + half, half),
+        build(source, x0 + half, y0 + half, half),
+    };
+
+    bool uniform = true;
+    for (auto &child : children)
+    {
+        if (child.children != -1 || child.value != children[0].value)
+        {
+            uniform = false;
+            break;
+        }
+    }
+
+    if (uniform)
+        return children[0];
+
+    int32_t first = alloc_children(children[0]);
+    std::copy(children, children + 4, nodes.begin() + first);
+    return Node { first, 0 };
+}
+
+int32_t
+QuadtreeBoard::alloc_children(const Node &fill)
+{
+    if (!free_blocks.empty())
+    {
+        int32_t first = free_blocks.back();
+        free_blocks.pop_back();
+        std::fill(nodes.begin() + first, nodes.begin() + first + 4, fill);
+        return first;
+    }
+    int32_t first = nodes.size();
+    nodes.insert(nodes.end(), 4, fill);
+    return first;
+}
+
+int
+QuadtreeBoard::at(int x, int y) const
+{
+    return node(x, y).value;
+}
+
+BoardNode
+QuadtreeBoard::node(int x, int y) const
+{
+    const Node *cur = &root;
+    int x0 = 0, y0 = 0, half = size;
+    while (cur->children != -1)
+    {
+        half /= 2;
+        int qx = x >= x0 + half;
+        int qy = y >= y0 + half;
+        x0 += qx * half;
+        y0 += qy * half;
+        cur = &nodes[cur->children + (qy << 1 | qx)];
+    }
+    return BoardNode {
+        cur->value,
+        CellPos(x0, y0),
+        CellPos(std::min(x0 + half, w), std::min(y0 + half, h)),
+    };
+}
+
+void
+QuadtreeBoard::set(int x, int y, int value)
+{
+    // indices of the nodes on the way down, -1 stands for the root
+    int32_t path[32];
+    int depth = 0;
+
+    int32_t cur = -1;
+    int x0 = 0, y0 = 0, half = size;
+    auto at_index = [this](int32_t i) -> Node & {
+        return i == -1 ? root : nodes[i];
+    };
+
+    while (half > 1)
+    {
+        Node &n = at_index(cur);
+        if (n.children == -1)
+        {
+            if (n.value == value)
+                return;
+            int32_t first = alloc_children(Node { -1, n.value });
+            // alloc_children may reallocate nodes, so look the parent up again
+            at_index(cur).children = first;
+        }
+        path[depth++] = cur;
+        half /= 2;
+        int qx = x >= x0 + half;
+        int qy = y >= y0 + half;
+        x0 += qx * half;
+        y0 += qy * half;
+        cur = at_index(cur).children + (qy << 1 | qx);
+    }
+    if (at_index(cur).value == value)
+        return;
+    at_index(cur).value = value;
+    touch();
+
+    // collapse the nodes that became uniform again
+    while (depth > 0)
+    {
+        Node &parent = at_index(path[--depth]);
+        const Node *children = &nodes[parent.children];
+        for (int i = 0; i < 4; i++)
+        {
+            if (children[i].children != -1 || children[i].value != children[0].value)
+                return;
+        }
+        free_blocks.push_back(parent.children);
+        parent = Node { -1, children[0].value };
+    }
+}
+
+size_t
+QuadtreeBoard::memory_footprint() const
+{
+    return nodes.capacity() * sizeof(Node) +
+           free_blocks.capacity() * sizeof(int32_t);
+}
+
+size_t
+QuadtreeBoard::node_count() const
+{
+    return nodes.size() - free_blocks.size() * 4 + 1;
+}
+
+/* Backends */
+
+std::unique_ptr<Board>
+make_board(BoardBackend backend, int w, int h, const CellSource &source)
+{
+    switch (backend)
+    {
+    case BoardBackend::Quadtree:
+        return std::make_unique<QuadtreeBoard>(w, h, source);
+    case BoardBackend::Chunked:
+    {
+        ChunkedBoardConfig config;
+        config.width = w;
+        config.height = h;
+        // the source is always at hand, so never show placeholder walls
+        config.policy = MissingChunkPolicy::Block;
+        return std::make_unique<ChunkedBoard>(config, source);
+    }
+    case BoardBackend::Dense:
+    default:
+        return std::make_unique<DenseBoard>(w, h, source);
+    }
+}
+
+const char *
+board_backend_name(BoardBackend backend)
+{
+    switch (backend)
+    {
+    case BoardBackend::Quadtree: return "quadtree";
+    case BoardBackend::Dense:    return "dense";
+    case BoardBackend::Chunked:  return "chunked";
+    }
+    return "unknown";
+}
+
+bool
+parse_board_backend(const std::string &name, BoardBackend &backend)
+{
+    if (name == "dense")
+        backend = BoardBackend::Dense;
+    else if (name == "quadtree")
+        backend = BoardBackend::Quadtree;
+    else if (name == "chunked")
+        backend = BoardBackend::Chunked;
+    else
+        return false;
+    return true;
+}
@@ -0,0 +1,133 @@
+#ifndef BOARD_HPP
+#define BOARD_HPP
+
+#include "world.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Uniform rectangle of cells [min, max) that contains a queried cell.
+// Ray casting uses it to skip over empty space in one step.
+struct BoardNode {
+    int value;
+    CellPos min, max;
+};
+
+using CellSource = std::function<int(int x, int y)>;
+
+class Board
+{
+public:
+    virtual ~Board() = default;
+
+    virtual int width() const = 0;
+    virtual int height() const = 0;
+
+    // x and y must be inside the board
+    virtual int at(int x, int y) const = 0;
+    virtual void set(int x, int y, int value) = 0;
+    virtual BoardNode node(int x, int y) const = 0;
+
+    // bytes used by the cell storage
+    virtual size_t memory_footprint() const = 0;
+
+    // called once per frame with the player position, lets streaming
+    // backends load the surroundings ahead of time
+    virtual void stream(const Vector2 &focus) { (void) focus; }
+
+    int at(CellPos pos) const
+    {
+        return at(pos.x, pos.y);
+    }
+
+    bool contains(int x, int y) const
+    {
+        return (x >= 0 && x < width()) && (y >= 0 && y < height());
+    }
+
+    bool contains(CellPos pos) const
+    {
+        return contains(pos.x, pos.y);
+    }
+
+    // Changes whenever a cell may read differently, so cached views of the
+    // board know when to redraw
+    uint64_t revision() const { return changes.load(std::memory_order_acquire); }
+
+protected:
+    void touch() { changes.fetch_add(1, std::memory_order_release); }
+
+private:
+    std::atomic<uint64_t> changes { 0 };
+};
+
+class DenseBoard : public Board
+{
+public:
+    DenseBoard(int w, int h);
+    DenseBoard(int w, int h, const CellSource &source);
+
+    int width() const override { return w; }
+    int height() const override { return h; }
+    int at(int x, int y) const override;
+    void set(int x, int y, int value) override;
+    BoardNode node(int x, int y) const override;
+    size_t memory_footprint() const override;
+
+private:
+    int w, h;
+    std::vector<uint8_t> cells;
+};
+
+// Region quadtree over a power of two square covering the board. Uniform
+// nodes are stored as a single leaf, so large empty areas cost nothing.
+class QuadtreeBoard : public Board
+{
+public:
+    QuadtreeBoard(int w, int h);
+    QuadtreeBoard(int w, int h, const CellSource &source);
+
+    int width() const override { return w; }
+    int height() const override { return h; }
+    int at(int x, int y) const override;
+    void set(int x, int y, int value) override;
+    BoardNode node(int x, int y) const override;
+    size_t memory_footprint() const override;
+
+    size_t node_count() const;
+
+private:
+    struct Node {
+        int32_t children; // index of the first of 4 children, -1 for leaves
+        uint8_t value;
+    };
+
+    Node build(const CellSource &source, int x0, int y0, int size);
+    int32_t alloc_children(const Node &fill);
+
+    int w, h;
+    int size;
+    Node root;
+    std::vector<Node> nodes;
+    std::vector<int32_t> free_blocks;
+};
+
+enum class BoardBackend {
+    Dense,
+    Quadtree,
+    Chunked,
+};
+
+std::unique_ptr<Board>
+make_board(BoardBackend backend, int w, int h, const CellSource &source);
+
+const char *
+board_backend_name(BoardBackend backend);
+
+bool
+parse_board_backend(const std::string &name, BoardBackend &backend);
+
+#endif // BOARD_HPP
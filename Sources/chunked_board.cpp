@@ -0,0 +1,301 @@
+#include "chunked_board.hpp"
+#include "trace.hpp"
+#include <algorithm>
+
+namespace {
+
+// Last chunk looked up by this thread. Holding a reference keeps the chunk
+// alive even if it is evicted meanwhile; the generation tells when the entry
+// no longer matches the table, and then the reference is dropped so evicted
+// chunks don't outlive the budget.
+struct ChunkCache {
+    uint64_t board = 0;
+    uint64_t generation = 0;
+    uint64_t key = 0;
+    std::shared_ptr<const void> chunk;
+};
+
+thread_local ChunkCache chunk_cache;
+
+std::atomic<uint64_t> next_board_id { 1 };
+
+}
+
+ChunkedBoard::ChunkedBoard(const ChunkedBoardConfig &config, ChunkLoader loader)
+    : config(config), loader(std::move(loader)), shift(0),
+      id(next_board_id.fetch_add(1))
+{
+    while ((1 << shift) < config.chunk_size)
+        shift++;
+    this->config.chunk_size = 1 << shift;
+    loader_thread = std::thread(&ChunkedBoard::load_loop, this);
+}
+
+ChunkedBoard::ChunkedBoard(const ChunkedBoardConfig &config,
+                           const CellSource &source)
+    : ChunkedBoard(config, [source, config](int x0, int y0, int size, uint8_t *cells) {
+        for (int y = 0; y < size; y++)
+            for (int x = 0; x < size; x++)
+                if (x0 + x < config.width && y0 + y < config.height)
+                    cells[y * size + x] = source(x0 + x, y0 + y);
+    })
+{
+}
+
+ChunkedBoard::~ChunkedBoard()
+{
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    queue_cv.notify_all();
+    loaded_cv.notify_all();
+    loader_thread.join();
+}
+
+uint64_t
+ChunkedBoard::chunk_key(int cx, int cy) const
+{
+    return uint64_t(uint32_t(cx)) << 32 | uint32_t(cy);
+}
+
+size_t
+ChunkedBoard::chunk_bytes() const
+{
+    return sizeof(Chunk) + size_t(config.chunk_size) * config.chunk_size;
+}
+
+void
+ChunkedBoard::request(uint64_t key, bool urgent) const
+{
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (requested.count(key))
+        {
+            if (urgent)
+            {
+                auto it = std::find(queue.begin(), queue.end(), key);
+                if (it != queue.end())
+                {
+                    queue.erase(it);
+                    queue.push_front(key);
+                }
+            }
+            return;
+        }
+        requested.insert(key);
+        if (urgent)
+            queue.push_front(key);
+        else
+            queue.push_back(key);
+    }
+    queue_cv.notify_one();
+}
+
+const ChunkedBoard::Chunk *
+ChunkedBoard::find_chunk(int cx, int cy, bool wait) const
+{
+    uint64_t key = chunk_key(cx, cy);
+    uint64_t gen = generation.load(std::memory_order_acquire);
+    if (chunk_cache.board == id && chunk_cache.generation == gen)
+    {
+        if (chunk_cache.key == key)
+        {
+            // a chunk only ever reached from here still counts as used
+            const Chunk *chunk = static_cast<const Chunk *>(chunk_cache.chunk.get());
+            chunk->last_used.store(tick.load(std::memory_order_relaxed),
+                                   std::memory_order_relaxed);
+            return chunk;
+        }
+    }
+    else
+    {
+        chunk_cache.chunk.reset();
+    }
+
+    for (;;)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(table_mutex);
+            auto it = chunks.find(key);
+            if (it != chunks.end())
+            {
+                it->second->last_used.store(tick.load(std::memory_order_relaxed),
+                                            std::memory_order_relaxed);
+                chunk_cache.board = id;
+                chunk_cache.generation = gen;
+                chunk_cache.key = key;
+                chunk_cache.chunk = it->second;
+                return it->second.get();
+            }
+        }
+
+        request(key, wait);
+        if (!wait)
+            return nullptr;
+
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        loaded_cv.wait(lock, [&] { return stopping || !requested.count(key); });
+        if (stopping)
+            return nullptr;
+    }
+}
+
+int
+ChunkedBoard::at(int x, int y) const
+{
+    bool wait = config.policy == MissingChunkPolicy::Block;
+    const Chunk *chunk = find_chunk(x >> shift, y >> shift, wait);
+    if (!chunk)
+        return config.solid_value;
+    int mask = config.chunk_size - 1;
+    return chunk->cells[(y & mask) << shift | (x & mask)];
+}
+
+BoardNode
+ChunkedBoard::node(int x, int y) const
+{
+    bool wait = config.policy == MissingChunkPolicy::Block;
+    const Chunk *chunk = find_chunk(x >> shift, y >> shift, wait);
+    if (!chunk || chunk->empty)
+    {
+        // the whole chunk is uniform, rays may skip it in one step
+        CellPos min((x >> shift) << shift, (y >> shift) << shift);
+        CellPos max(std::min(min.x + config.chunk_size, config.width),
+                    std::min(min.y + config.chunk_size, config.height));
+        return BoardNode { chunk ? 0 : config.solid_value, min, max };
+    }
+    int mask = config.chunk_size - 1;
+    int value = chunk->cells[(y & mask) << shift | (x & mask)];
+    return BoardNode { value, CellPos(x, y), CellPos(x + 1, y + 1) };
+}
+
+void
+ChunkedBoard::set(int x, int y, int value)
+{
+    auto chunk = const_cast<Chunk *>(find_chunk(x >> shift, y >> shift, true));
+    if (!chunk)
+        return;
+    int mask = config.chunk_size - 1;
+    chunk->cells[(y & mask) << shift | (x & mask)] = value;
+    chunk->modified = true;
+    touch();
+    if (value != 0)
+        chunk->empty = false;
+}
+
+size_t
+ChunkedBoard::memory_footprint() const
+{
+    return resident_chunks() * chunk_bytes();
+}
+
+size_t
+ChunkedBoard::resident_chunks() const
+{
+    std::shared_lock<std::shared_mutex> lock(table_mutex);
+    return chunks.size();
+}
+
+void
+ChunkedBoard::stream(const Vector2 &focus)
+{
+    uint64_t now = tick.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    CellPos cell(get_cell(focus));
+    int fx = cell.x >> shift;
+    int fy = cell.y >> shift;
+    int max_cx = (config.width - 1) >> shift;
+    int max_cy = (config.height - 1) >> shift;
+    for (int cy = std::max(fy - config.load_radius, 0);
+         cy <= std::min(fy + config.load_radius, max_cy); cy++)
+    {
+        for (int cx = std::max(fx - config.load_radius, 0);
+             cx <= std::min(fx + config.load_radius, max_cx); cx++)
+        {
+            uint64_t key = chunk_key(cx, cy);
+            std::shared_lock<std::shared_mutex> lock(table_mutex);
+            auto it = chunks.find(key);
+            if (it != chunks.end())
+                it->second->last_used.store(now, std::memory_order_relaxed);
+            else
+                request(key, false);
+        }
+    }
+
+    evict();
+}
+
+void
+ChunkedBoard::evict()
+{
+    size_t budget_chunks = std::max<size_t>(config.memory_budget / chunk_bytes(), 1);
+
+    std::unique_lock<std::shared_mutex> lock(table_mutex);
+    if (chunks.size() <= budget_chunks)
+        return;
+
+    // Modified chunks have nowhere to go and stay resident, everything else
+    // goes oldest first. Chunks touched this tick surround the focus.
+    uint64_t now = tick.load(std::memory_order_relaxed);
+    std::vector<std::pair<uint64_t, uint64_t>> candidates;
+    for (auto &[key, chunk] : chunks)
+    {
+        uint64_t used = chunk->last_used.load(std::memory_order_relaxed);
+        if (!chunk->modified && used < now)
+            candidates.emplace_back(used, key);
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    size_t excess = chunks.size() - budget_chunks;
+    size_t erased = std::min(candidates.size(), excess);
+    for (size_t i = 0; i < erased; i++)
+        chunks.erase(candidates[i].second);
+    // over budget with nothing to let go changes nothing
+    if (erased == 0)
+        return;
+    generation.fetch_add(1, std::memory_order_release);
+    // with MissingChunkPolicy::Solid evicted chunks read as walls
+    touch();
+}
+
+void
+ChunkedBoard::load_loop()
+{
+    trace_thread_name("chunk loader");
+    for (;;)
+    {
+        uint64_t key;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_cv.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping)
+                return;
+            key = queue.front();
+            queue.pop_front();
+        }
+
+        TRACE_SCOPE("load_chunk");
+        auto chunk = std::make_shared<Chunk>();
+        chunk->cx = int(key >> 32);
+        chunk->cy = int(uint32_t(key));
+        chunk->cells.assign(size_t(config.chunk_size) * config.chunk_size, 0);
+        loader(chunk->cx << shift, chunk->cy << shift, config.chunk_size,
+               chunk->cells.data());
+        chunk->empty = std::all_of(chunk->cells.begin(), chunk->cells.end(),
+                                   [](uint8_t c) { return c == 0; });
+        chunk->modified = false;
+        chunk->last_used = tick.load(std::memory_order_relaxed);
+
+        {
+            std::unique_lock<std::shared_mutex> lock(table_mutex);
+            chunks.emplace(key, std::move(chunk));
+        }
+        touch();
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            requested.erase(key);
+        }
+        loaded_cv.notify_all();
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef CHUNKED_BOARD_HPP
+#define CHUNKED_BOARD_HPP
+
+#include "board.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+enum class MissingChunkPolicy {
+    Solid, // queries see a wall until the chunk arrives
+    Block, // queries wait for the loader
+};
+
+struct ChunkedBoardConfig {
+    int width = 1 << 20;
+    int height = 1 << 20;
+    int chunk_size = 64; // power of two
+    size_t memory_budget = 64u << 20;
+    int load_radius = 2; // in chunks around the streaming focus
+    MissingChunkPolicy policy = MissingChunkPolicy::Solid;
+    int solid_value = 1;
+};
+
+// Fills a chunk_size x chunk_size block of cells, row by row, with the cells
+// starting at (x0, y0). Runs on the loader thread.
+using ChunkLoader = std::function<void(int x0, int y0, int size, uint8_t *cells)>;
+
+// Board split into fixed size chunks that are loaded on a background thread
+// around the streaming focus and evicted least recently used first once the
+// resident chunks exceed the memory budget. Queries are safe from any thread;
+// set() must not overlap with queries.
+class ChunkedBoard : public Board
+{
+public:
+    ChunkedBoard(const ChunkedBoardConfig &config, ChunkLoader loader);
+    ChunkedBoard(const ChunkedBoardConfig &config, const CellSource &source);
+    ~ChunkedBoard();
+
+    int width() const override { return config.width; }
+    int height() const override { return config.height; }
+    int at(int x, int y) const override;
+    void set(int x, int y, int value) override;
+    BoardNode node(int x, int y) const override;
+    size_t memory_footprint() const override;
+    void stream(const Vector2 &focus) override;
+
+    size_t resident_chunks() const;
+
+private:
+    struct Chunk {
+        int cx, cy;
+        std::vector<uint8_t> cells;
+        bool empty;
+        bool modified;
+        mutable std::atomic<uint64_t> last_used; // bumped through const lookups
+    };
+
+    uint64_t chunk_key(int cx, int cy) const;
+    const Chunk *find_chunk(int cx, int cy, bool wait) const;
+    void request(uint64_t key, bool urgent) const;
+    void load_loop();
+    void evict();
+    size_t chunk_bytes() const;
+
+    ChunkedBoardConfig config;
+    ChunkLoader loader;
+    int shift;
+    uint64_t id;
+
+    mutable std::shared_mutex table_mutex;
+    std::unordered_map<uint64_t, std::shared_ptr<Chunk>> chunks;
+    std::atomic<uint64_t> generation { 0 };
+    std::atomic<uint64_t> tick { 0 };
+
+    mutable std::mutex queue_mutex;
+    mutable std::condition_variable queue_cv;
+    mutable std::condition_variable loaded_cv;
+    mutable std::deque<uint64_t> queue;
+    mutable std::unordered_set<uint64_t> requested;
+    bool stopping = false;
+    std::thread loader_thread;
+};
+
+#endif // CHUNKED_BOARD_HPP
@@ -0,0 +1,118 @@
+#include "debug_draw.hpp"
+#include <algorithm>
+
+// view rays, paths and collisions are on by default, as the old defines were
+static std::atomic<uint32_t> enabled_categories {
+    (1u << int(DebugCategory::ViewRays)) |
+    (1u << int(DebugCategory::Paths)) |
+    (1u << int(DebugCategory::Collisions))
+};
+
+const char *
+debug_category_name(DebugCategory category)
+{
+    switch (category)
+    {
+    case DebugCategory::ViewRays:   return "view rays";
+    case DebugCategory::Paths:      return "paths";
+    case DebugCategory::Collisions: return "collisions";
+    case DebugCategory::SpriteRays: return "sprite rays";
+    case DebugCategory::Count:      break;
+    }
+    return "unknown";
+}
+
+bool
+debug_enabled(DebugCategory category)
+{
+    return enabled_categories.load(std::memory_order_relaxed) & (1u << int(category));
+}
+
+void
+debug_set_enabled(DebugCategory category, bool enabled)
+{
+    if (enabled)
+        enabled_categories.fetch_or(1u << int(category), std::memory_order_relaxed);
+    else
+        enabled_categories.fetch_and(~(1u << int(category)), std::memory_order_relaxed);
+}
+
+DebugDraw::DebugDraw(int capacity)
+    : commands(capacity)
+{
+}
+
+DebugDraw::DebugDraw(const DebugDraw &other)
+    : commands(other.commands.size())
+{
+    *this = other;
+}
+
+DebugDraw &
+DebugDraw::operator=(const DebugDraw &other)
+{
+    int n = std::min(other.size(), int(commands.size()));
+    std::copy(other.commands.begin(), other.commands.begin() + n, commands.begin());
+    count.store(n, std::memory_order_relaxed);
+    return *this;
+}
+
+int
+DebugDraw::size() const
+{
+    return std::min(count.load(std::memory_order_relaxed), int(commands.size()));
+}
+
+void
+DebugDraw::record(const DebugCommand &command)
+{
+    int slot = count.fetch_add(1, std::memory_order_relaxed);
+    if (slot < int(commands.size()))
+        commands[slot] = command;
+}
+
+void
+DebugDraw::line(DebugCategory category, Vector2 a, Vector2 b, float thick, Color color)
+{
+    if (debug_enabled(category))
+        record({ DebugCommand::Line, category, color, a, b, thick });
+}
+
+void
+DebugDraw::circle(DebugCategory category, Vector2 center, float radius, Color color)
+{
+    if (debug_enabled(category))
+        record({ DebugCommand::Circle, category, color, center, { 0, 0 }, radius });
+}
+
+void
+DebugDraw::rect(DebugCategory category, Vector2 pos, Vector2 size, Color color)
+{
+    if (debug_enabled(category))
+        record({ DebugCommand::Rect, category, color, pos, size, 0 });
+}
+
+void
+DebugDraw::replay() const
+{
+    uint32_t enabled = enabled_categories.load(std::memory_order_relaxed);
+    int n = size();
+    for (int i = 0; i < n; i++)
+    {
+        const DebugCommand &command = commands[i];
+        if (!(enabled & (1u << int(command.category))))
+            continue;
+        switch (command.shape)
+        {
+        case DebugCommand::Line:
+            DrawLineEx(command.a, command.b, command.size, command.color);
+            break;
+        case DebugCommand::Circle:
+            DrawCircleV(command.a, command.size, command.color);
+            break;
+        case DebugCommand::Rect:
+            DrawRectangleV(command.a, command.b, command.color);
+            break;
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef DEBUG_DRAW_HPP
+#define DEBUG_DRAW_HPP
+
+#include <raylib-ext.hpp>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+enum class DebugCategory : uint8_t {
+    ViewRays,   // a line per view column
+    Paths,      // agent paths
+    Collisions, // cells the player was pushed out of
+    SpriteRays, // lines to the edges of every sprite
+    Count,
+};
+
+const char *
+debug_category_name(DebugCategory category);
+
+// Switched at runtime, any thread
+bool
+debug_enabled(DebugCategory category);
+void
+debug_set_enabled(DebugCategory category, bool enabled);
+
+struct DebugCommand {
+    enum Shape : uint8_t { Line, Circle, Rect };
+
+    Shape shape;
+    DebugCategory category;
+    Color color;
+    Vector2 a; // line start, circle center, rectangle corner
+    Vector2 b; // line end, rectangle size
+    float size; // line thickness, circle radius
+};
+
+// Primitives recorded during a frame and drawn later in one pass onto
+// whatever render target is current, so hot code never switches render
+// targets itself. Any thread may record: a command claims its slot with one
+// atomic add. Replaying, copying and clearing must not overlap recording,
+// the owner waits for the jobs of the frame first. Disabled categories are
+// not recorded, commands past the capacity are dropped.
+class DebugDraw
+{
+public:
+    explicit DebugDraw(int capacity = 4096);
+    DebugDraw(const DebugDraw &other);
+    DebugDraw &operator=(const DebugDraw &other);
+
+    void line(DebugCategory category, Vector2 a, Vector2 b, float thick, Color color);
+    void circle(DebugCategory category, Vector2 center, float radius, Color color);
+    void rect(DebugCategory category, Vector2 pos, Vector2 size, Color color);
+
+    void clear() { count.store(0, std::memory_order_relaxed); }
+    int size() const;
+
+    // Skips the categories disabled since recording
+    void replay() const;
+
+private:
+    void record(const DebugCommand &command);
+
+    std::vector<DebugCommand> commands; // sized once, never grows
+    std::atomic<int> count { 0 };
+};
+
+#endif // DEBUG_DRAW_HPP
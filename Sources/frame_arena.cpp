@@ -0,0 +1,58 @@
+#include "frame_arena.hpp"
+#include "alloc_counter.hpp"
+#include <algorithm>
+
+FrameArena::FrameArena(size_t capacity)
+    : buffer(new unsigned char[capacity]), size(capacity)
+{
+}
+
+void *
+FrameArena::allocate(size_t bytes, size_t align)
+{
+    size_t start = (top + align - 1) & ~(align - 1);
+    if (start + bytes > size)
+    {
+        // the fallback the arena is built around, not a stray allocation
+        AllowAllocations allow;
+        overflow += bytes;
+        return ::operator new(bytes);
+    }
+    top = start + bytes;
+    peak = std::max(peak, top);
+    return buffer.get() + start;
+}
+
+void
+FrameArena::deallocate(void *p, size_t bytes)
+{
+    if (!owns(p))
+    {
+        ::operator delete(p);
+        return;
+    }
+    // the newest block can be given back right away, which lets a growing
+    // vector reuse its old storage
+    if (static_cast<unsigned char *>(p) + bytes == buffer.get() + top)
+        top -= bytes;
+}
+
+void
+FrameArena::rollback(size_t mark)
+{
+    top = mark;
+    if (top == 0 && overflow > 0)
+    {
+        AllowAllocations allow;
+        size = std::max(size * 2, size + overflow);
+        buffer.reset(new unsigned char[size]);
+        overflow = 0;
+    }
+}
+
+FrameArena &
+frame_arena()
+{
+    thread_local FrameArena arena(1 << 20);
+    return arena;
+}
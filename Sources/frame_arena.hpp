@@ -0,0 +1,97 @@
+#ifndef FRAME_ARENA_HPP
+#define FRAME_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Bump allocator for data that lives no longer than a frame. Scopes mark the
+// top and roll back to it; memory is never handed back to the heap. Requests
+// that don't fit go to operator new, outside the allocation count, and the
+// next rollback to an empty arena grows it so the following frames fit again.
+class FrameArena
+{
+public:
+    explicit FrameArena(size_t capacity);
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    void *allocate(size_t bytes, size_t align);
+    void deallocate(void *p, size_t bytes);
+
+    size_t mark() const { return top; }
+    void rollback(size_t mark);
+
+    size_t capacity() const { return size; }
+    size_t high_water() const { return peak; }
+
+private:
+    bool owns(const void *p) const
+    {
+        return p >= buffer.get() && p < buffer.get() + size;
+    }
+
+    std::unique_ptr<unsigned char[]> buffer;
+    size_t size;
+    size_t top = 0;
+    size_t peak = 0;
+    size_t overflow = 0; // bytes that went to the heap since the arena was empty
+};
+
+// One arena per thread
+FrameArena &
+frame_arena();
+
+class ArenaScope
+{
+public:
+    explicit ArenaScope(FrameArena &arena = frame_arena())
+        : arena(arena), start(arena.mark()) {}
+    ~ArenaScope() { arena.rollback(start); }
+
+    ArenaScope(const ArenaScope &) = delete;
+    ArenaScope &operator=(const ArenaScope &) = delete;
+
+private:
+    FrameArena &arena;
+    size_t start;
+};
+
+template <class T>
+struct FrameAllocator {
+    using value_type = T;
+
+    FrameArena *arena;
+
+    FrameAllocator() : arena(&frame_arena()) {}
+    template <class U>
+    FrameAllocator(const FrameAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t n)
+    {
+        return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T *p, size_t n) { arena->deallocate(p, n * sizeof(T)); }
+
+    template <class U>
+    bool operator==(const FrameAllocator<U> &other) const { return arena == other.arena; }
+    template <class U>
+    bool operator!=(const FrameAllocator<U> &other) const { return arena != other.arena; }
+};
+
+// Containers on the arena have to die inside the ArenaScope they were made in
+template <class T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+template <class T, class Hash>
+using FrameSet = std::unordered_set<T, Hash, std::equal_to<T>, FrameAllocator<T>>;
+
+template <class K, class V, class Hash>
+using FrameMap = std::unordered_map<K, V, Hash, std::equal_to<K>,
+                                    FrameAllocator<std::pair<const K, V>>>;
+
+#endif // FRAME_ARENA_HPP
@@ -0,0 +1,116 @@
+#include "frame_cache.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+
+bool
+FrameCache::view_changed(const Board &board, uint64_t revision, const Player &player,
+                         float fov, const Framebuffer &fb, const RenderSettings &settings)
+{
+    view_dirty = !valid || &board != this->board || revision != board_revision ||
+                 !(player.pos == pos) || player.rotation != rotation || fov != this->fov ||
+                 fb.width != width || fb.height != height ||
+                 settings.floor_step != floor_step || settings.features != features;
+    if (view_dirty)
+    {
+        this->board = &board;
+        board_revision = revision;
+        pos = player.pos;
+        rotation = player.rotation;
+        this->fov = fov;
+        width = fb.width;
+        height = fb.height;
+        floor_step = settings.floor_step;
+        features = settings.features;
+    }
+    return view_dirty;
+}
+
+bool
+FrameCache::sprites_changed(const std::vector<Object> &objects) const
+{
+    if (objects.size() != sprites.size())
+        return true;
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        const SpriteState &s = sprites[i];
+        if (objects[i].id != s.id || !(objects[i].pos == s.pos) || objects[i].image.data != s.image)
+            return true;
+    }
+    return false;
+}
+
+void
+FrameCache::save_sprites(const Framebuffer &fb, const ColumnBuffer &columns,
+                         const std::vector<Object> &objects)
+{
+    sprites.clear();
+    for (const Object &object : objects)
+    {
+        sprites.push_back(SpriteState {
+            object.id,
+            object.pos,
+            object.image.data,
+            sprite_bounds(fb, columns, object),
+        });
+    }
+}
+
+FrameUpdate
+FrameCache::render(Framebuffer &fb,
+                   const Player &player,
+                   const ColumnBuffer &columns,
+                   const std::vector<Object> &objects,
+                   const RenderAssets &assets,
+                   const RenderSettings &settings)
+{
+    if (view_dirty || !valid)
+    {
+        {
+            PROFILE_SCOPE(Stage::FloorCeiling);
+            render_floor(fb, columns, assets, settings);
+        }
+        {
+            PROFILE_SCOPE(Stage::Walls);
+            render_walls(fb, columns, assets, settings);
+        }
+        PROFILE_SCOPE(Stage::Sprites);
+        background.assign(fb.pixels.begin(), fb.pixels.end());
+        render_sprites(fb, player, columns, objects, settings);
+        save_sprites(fb, columns, objects);
+        valid = true;
+        view_dirty = false;
+        return FrameUpdate::Full;
+    }
+
+    if (!sprites_changed(objects))
+        return FrameUpdate::None;
+
+    PROFILE_SCOPE(Stage::Sprites);
+    // everything under the old rectangles goes back to the background,
+    // then the new ones join them
+    dirty_columns.assign(fb.width, 0);
+    RenderClip clip { dirty_columns.data(), fb.height, 0 };
+    auto mark = [&](const SpriteBounds &b) {
+        if (b.x0 >= b.x1)
+            return;
+        std::fill(dirty_columns.begin() + b.x0, dirty_columns.begin() + b.x1, 1);
+        clip.y0 = std::min(clip.y0, b.y0);
+        clip.y1 = std::max(clip.y1, b.y1);
+    };
+    for (const SpriteState &s : sprites)
+        mark(s.bounds);
+    save_sprites(fb, columns, objects);
+    for (const SpriteState &s : sprites)
+        mark(s.bounds);
+    if (clip.y0 >= clip.y1)
+        return FrameUpdate::Sprites;
+
+    for (int y = clip.y0; y < clip.y1; y++)
+    {
+        for (int x = 0; x < fb.width; x++)
+            if (dirty_columns[x])
+                fb.pixels[fb.index(x, y)] = background[fb.index(x, y)];
+    }
+    render_sprites(fb, player, columns, objects, settings, &clip);
+    return FrameUpdate::Sprites;
+}
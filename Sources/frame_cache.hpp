@@ -0,0 +1,67 @@
+#ifndef FRAME_CACHE_HPP
+#define FRAME_CACHE_HPP
+
+#include "board.hpp"
+#include "raycast.hpp"
+#include "render.hpp"
+#include "world.hpp"
+#include <vector>
+
+enum class FrameUpdate {
+    None,    // the last frame is still right
+    Sprites, // only the sprites' old and new rectangles were redrawn
+    Full,
+};
+
+// Remembers what the last frame was drawn from. A frame nothing changed
+// for is reused as it is; when only sprites moved, the rectangles they
+// covered and cover now are restored from a sprite-free copy of the view
+// and the sprites are drawn again clipped to them.
+class FrameCache
+{
+public:
+    // Call before casting; false means the columns from last frame still hold.
+    // revision is the board revision the drawn world goes with, the one in
+    // its snapshot rather than whatever the board is at by now.
+    bool view_changed(const Board &board, uint64_t revision, const Player &player,
+                      float fov, const Framebuffer &fb, const RenderSettings &settings);
+
+    FrameUpdate render(Framebuffer &fb,
+                       const Player &player,
+                       const ColumnBuffer &columns,
+                       const std::vector<Object> &objects,
+                       const RenderAssets &assets,
+                       const RenderSettings &settings);
+
+    void invalidate() { valid = false; }
+
+private:
+    struct SpriteState {
+        size_t id;
+        Vector2 pos;
+        const void *image;
+        SpriteBounds bounds;
+    };
+
+    bool sprites_changed(const std::vector<Object> &objects) const;
+    void save_sprites(const Framebuffer &fb, const ColumnBuffer &columns,
+                      const std::vector<Object> &objects);
+
+    bool valid = false;
+    bool view_dirty = true;
+    const Board *board = nullptr;
+    uint64_t board_revision = 0;
+    Vector2 pos = { 0, 0 };
+    float rotation = 0;
+    float fov = 0;
+    int width = 0;
+    int height = 0;
+    int floor_step = 0;
+    uint8_t features = 0;
+
+    std::vector<Color> background; // floor and walls, no sprites
+    std::vector<SpriteState> sprites;
+    std::vector<uint8_t> dirty_columns;
+};
+
+#endif // FRAME_CACHE_HPP
@@ -0,0 +1,289 @@
+#include "gpu_view.hpp"
+#include <algorithm>
+
+static Texture2D
+upload_texture(const Image &image, int wrap)
+{
+    Texture2D texture = LoadTextureFromImage(image);
+    SetTextureFilter(texture, TEXTURE_FILTER_POINT);
+    SetTextureWrap(texture, wrap);
+    return texture;
+}
+
+ViewTextures
+upload_view_textures(const RenderAssets &assets, const std::vector<Image> &sprite_images)
+{
+    ViewTextures textures;
+    for (const Image &image : assets.walls)
+        textures.walls.push_back(upload_texture(image, TEXTURE_WRAP_CLAMP));
+    // floor strips run across many cells, the texture repeats per cell
+    textures.floor = upload_texture(assets.floor, TEXTURE_WRAP_REPEAT);
+    textures.ceiling = upload_texture(assets.ceiling, TEXTURE_WRAP_REPEAT);
+    for (const Image &image : sprite_images)
+        textures.sprites.emplace_back(image.data, upload_texture(image, TEXTURE_WRAP_CLAMP));
+    return textures;
+}
+
+void
+unload_view_textures(ViewTextures &textures)
+{
+    for (Texture2D &texture : textures.walls)
+        UnloadTexture(texture);
+    UnloadTexture(textures.floor);
+    UnloadTexture(textures.ceiling);
+    for (auto &sprite : textures.sprites)
+        UnloadTexture(sprite.second);
+    textures = ViewTextures {};
+}
+
+// The vertex tint that darkens like RENDER_SHADING
+static Color
+shade_tint(float dist, const RenderSettings &settings)
+{
+    if (!(settings.features & RENDER_SHADING))
+        return WHITE;
+    float shade = dist / settings.light_dist;
+    unsigned char light = (unsigned char) (255 * (1 - std::min(shade * shade, 1.0f)));
+    return Color { light, light, light, 255 };
+}
+
+// A flat quad over a surface that fogs it like RENDER_FOG, alpha 0 without
+static Color
+fog_tint(float dist, const RenderSettings &settings)
+{
+    Color fog = settings.fog_color;
+    fog.a = 0;
+    if (settings.features & RENDER_FOG)
+        fog.a = (unsigned char) (255 * std::min(dist / settings.fog_dist, 1.0f));
+    return fog;
+}
+
+// u runs along the quad's width and v along its height
+static ViewQuad
+textured_quad(unsigned texture, float x0, float y0, float x1, float y1,
+              Vector2 top_left, Vector2 bottom_right, Color tint)
+{
+    return ViewQuad {
+        texture, x0, y0, x1, y1,
+        {
+            top_left,
+            { top_left.x, bottom_right.y },
+            bottom_right,
+            { bottom_right.x, top_left.y },
+        },
+        tint,
+    };
+}
+
+// Cuts the rows outside [0, height) off a quad, keeping its texture in place
+static bool
+clip_rows(ViewQuad &quad, int height)
+{
+    float y0 = std::max(quad.y0, 0.0f);
+    float y1 = std::min(quad.y1, float(height));
+    if (y0 >= y1)
+        return false;
+
+    float span = quad.y1 - quad.y0;
+    float t0 = (y0 - quad.y0) / span;
+    float t1 = (y1 - quad.y0) / span;
+    Vector2 top_left = Vector2Lerp(quad.uv[0], quad.uv[1], t0);
+    Vector2 bottom_left = Vector2Lerp(quad.uv[0], quad.uv[1], t1);
+    Vector2 bottom_right = Vector2Lerp(quad.uv[3], quad.uv[2], t1);
+    Vector2 top_right = Vector2Lerp(quad.uv[3], quad.uv[2], t0);
+    quad.uv[0] = top_left;
+    quad.uv[1] = bottom_left;
+    quad.uv[2] = bottom_right;
+    quad.uv[3] = top_right;
+    quad.y0 = y0;
+    quad.y1 = y1;
+    return true;
+}
+
+static void
+add_floor_quads(FrameVector<ViewQuad> &quads, int width, int height,
+                const ColumnBuffer &columns, const ViewTextures &textures,
+                const RenderSettings &settings)
+{
+    int horizon = height / 2;
+    float cam_height = 0.5f * height;
+    Vector2 origin = columns.origin / cell_size;
+    // render_floor samples column x at plane[x], the middle of the column,
+    // so the strip edges sit half a column further out
+    float plane_x1 = columns.plane_half * (2.0f * width / columns.count - 1);
+    Vector2 left = columns.forward - columns.right * columns.plane_half;
+    Vector2 right = columns.forward + columns.right * plane_x1;
+
+    size_t first = quads.size();
+    for (int y = 0; y < horizon; y += settings.floor_step)
+    {
+        // the whole band shares the sample of its top row
+        float row_dist = cam_height / (horizon - y);
+        Vector2 uv0 = origin + left * row_dist;
+        Vector2 uv1 = origin + right * row_dist;
+        Color tint = shade_tint(row_dist * cell_size, settings);
+
+        int rows = std::min(settings.floor_step, horizon - y);
+        quads.push_back({ textures.ceiling.id, 0, float(y), float(width), float(y + rows),
+                          { uv0, uv0, uv1, uv1 }, tint });
+        quads.push_back({ textures.floor.id, 0, float(height - y - rows), float(width),
+                          float(height - y), { uv0, uv0, uv1, uv1 }, tint });
+    }
+    if (!(settings.features & RENDER_FOG))
+        return;
+    size_t last = quads.size();
+    for (size_t i = first; i < last; i++)
+    {
+        ViewQuad fog = quads[i];
+        float row_dist = cam_height / (horizon - (fog.texture == textures.ceiling.id
+                                                   ? fog.y0 : height - fog.y1));
+        fog.texture = 0;
+        fog.tint = fog_tint(row_dist * cell_size, settings);
+        quads.push_back(fog);
+    }
+}
+
+// render_walls fills the rows whose top edge is inside the wall and samples
+// there; half a row lower, the quad covers and samples the same rows by
+// their centers
+static ViewQuad
+wall_quad(int x, int height, const ColumnBuffer &columns, const ViewTextures &textures)
+{
+    float dist = columns.perp_dist[x];
+    float rect_h = (cell_size * height) / dist;
+    float rect_y = (height - rect_h) / 2;
+    const Texture2D &texture = textures.walls[columns.tex_id[x]];
+    float u = (int(columns.tex_u[x] * texture.width) + 0.5f) / texture.width;
+    float y0 = rect_y + 0.5f;
+    return textured_quad(texture.id, float(x), y0, float(x + 1), y0 + rect_h,
+                         { u, 0 }, { u, 1 }, WHITE);
+}
+
+static void
+add_wall_quads(FrameVector<ViewQuad> &quads, int width, int height,
+               const ColumnBuffer &columns, const ViewTextures &textures,
+               const RenderSettings &settings)
+{
+    size_t first = quads.size();
+    // walls never overlap, grouping them by texture keeps one draw each
+    for (size_t id = 0; id < textures.walls.size(); id++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            if (columns.tex_id[x] != id)
+                continue;
+            ViewQuad quad = wall_quad(x, height, columns, textures);
+            quad.tint = shade_tint(columns.perp_dist[x], settings);
+            if (clip_rows(quad, height))
+                quads.push_back(quad);
+        }
+    }
+    if (!(settings.features & RENDER_FOG))
+        return;
+    size_t last = quads.size();
+    for (size_t i = first; i < last; i++)
+    {
+        ViewQuad fog = quads[i];
+        fog.texture = 0;
+        fog.tint = fog_tint(columns.perp_dist[int(fog.x0)], settings);
+        quads.push_back(fog);
+    }
+}
+
+static const Texture2D *
+find_sprite_texture(const ViewTextures &textures, const Image &image)
+{
+    for (auto &sprite : textures.sprites)
+    {
+        if (sprite.first == image.data)
+            return &sprite.second;
+    }
+    return nullptr;
+}
+
+static void
+add_sprite_quads(FrameVector<ViewQuad> &quads, int width, int height,
+                 const Player &player, const ColumnBuffer &columns,
+                 const std::vector<Object> &objects, const ViewTextures &textures,
+                 const RenderSettings &settings)
+{
+    for (size_t i : get_render_order(player, objects))
+    {
+        const Texture2D *texture = find_sprite_texture(textures, objects[i].image);
+        SpriteProjection p;
+        if (!texture || !project_sprite(width, height, columns, objects[i], p))
+            continue;
+
+        Color tint = shade_tint(p.depth, settings);
+        float y0 = p.rect_y + 0.5f; // as for walls
+        // one quad per run of columns no wall hides it in
+        int x = p.bounds.x0;
+        while (x < p.bounds.x1)
+        {
+            if (p.depth >= columns.perp_dist[x])
+            {
+                x++;
+                continue;
+            }
+            int run_start = x;
+            while (x < p.bounds.x1 && p.depth < columns.perp_dist[x])
+                x++;
+            float u0 = (run_start - 0.5f - p.x_start) / (p.x_end - p.x_start);
+            float u1 = (x - 0.5f - p.x_start) / (p.x_end - p.x_start);
+            ViewQuad quad = textured_quad(texture->id, float(run_start), y0, float(x),
+                                          y0 + p.rect_h, { u0, 0 }, { u1, 1 }, tint);
+            if (clip_rows(quad, height))
+                quads.push_back(quad);
+        }
+    }
+}
+
+FrameVector<ViewQuad>
+build_view_quads(int width, int height,
+                 const Player &player,
+                 const ColumnBuffer &columns,
+                 const std::vector<Object> &objects,
+                 const ViewTextures &textures,
+                 const RenderSettings &settings)
+{
+    FrameVector<ViewQuad> quads;
+    width = std::min(width, columns.count);
+    if (width <= 0 || height <= 0)
+        return quads;
+
+    quads.reserve(2 * height / settings.floor_step + 2 * width + 64);
+    add_floor_quads(quads, width, height, columns, textures, settings);
+    add_wall_quads(quads, width, height, columns, textures, settings);
+    add_sprite_quads(quads, width, height, player, columns, objects, textures, settings);
+    return quads;
+}
+
+void
+draw_view_quads(const FrameVector<ViewQuad> &quads, int width, int height, Rectangle dst)
+{
+    if (width <= 0 || height <= 0)
+        return;
+
+    rlPushMatrix();
+    rlTranslatef(dst.x, dst.y, 0);
+    rlScalef(dst.width / width, dst.height / height, 1);
+    for (const ViewQuad &quad : quads)
+    {
+        // the batch only starts a new draw call when the texture changes
+        rlCheckRenderBatchLimit(4);
+        rlSetTexture(quad.texture ? quad.texture : rlGetTextureIdDefault());
+        rlBegin(RL_QUADS);
+        rlColor4ub(quad.tint.r, quad.tint.g, quad.tint.b, quad.tint.a);
+        rlTexCoord2f(quad.uv[0].x, quad.uv[0].y);
+        rlVertex2f(quad.x0, quad.y0);
+        rlTexCoord2f(quad.uv[1].x, quad.uv[1].y);
+        rlVertex2f(quad.x0, quad.y1);
+        rlTexCoord2f(quad.uv[2].x, quad.uv[2].y);
+        rlVertex2f(quad.x1, quad.y1);
+        rlTexCoord2f(quad.uv[3].x, quad.uv[3].y);
+        rlVertex2f(quad.x1, quad.y0);
+        rlEnd();
+    }
+    rlSetTexture(0);
+    rlPopMatrix();
+}
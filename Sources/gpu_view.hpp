@@ -0,0 +1,54 @@
+#ifndef GPU_VIEW_HPP
+#define GPU_VIEW_HPP
+
+#include "frame_arena.hpp"
+#include "raycast.hpp"
+#include "render.hpp"
+#include "world.hpp"
+#include <utility>
+#include <vector>
+
+// GPU copies of the render assets, uploaded once after the window opened
+struct ViewTextures {
+    std::vector<Texture2D> walls; // indexed by board cell value, as the images
+    Texture2D floor;
+    Texture2D ceiling;
+    std::vector<std::pair<const void *, Texture2D>> sprites; // by image data
+};
+
+ViewTextures
+upload_view_textures(const RenderAssets &assets, const std::vector<Image> &sprite_images);
+
+void
+unload_view_textures(ViewTextures &textures);
+
+// One textured quad in frame coordinates; texture 0 draws flat colour
+struct ViewQuad {
+    unsigned texture;
+    float x0, y0, x1, y1;
+    Vector2 uv[4]; // top left, bottom left, bottom right, top right
+    Color tint;
+};
+
+// The view render_view draws, as quads instead of pixels: a strip per
+// floor and ceiling row band, a quad per wall column and one per run of
+// visible sprite columns, in drawing order with the walls grouped by
+// texture. Textures are sampled where render_view samples them, so with
+// nearest filtering the two agree pixel for pixel.
+//
+// Shading is a vertex tint and fog a flat quad over floors and walls;
+// sprites aren't fogged, always blend by alpha and there is no depth debug.
+FrameVector<ViewQuad>
+build_view_quads(int width, int height,
+                 const Player &player,
+                 const ColumnBuffer &columns,
+                 const std::vector<Object> &objects,
+                 const ViewTextures &textures,
+                 const RenderSettings &settings);
+
+// Through the rlgl batch, so a frame is a handful of draw calls;
+// the width x height frame is stretched over dst
+void
+draw_view_quads(const FrameVector<ViewQuad> &quads, int width, int height, Rectangle dst);
+
+#endif // GPU_VIEW_HPP
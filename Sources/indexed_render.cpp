@@ -0,0 +1,243 @@
+#include "indexed_render.hpp"
+#include "jobs.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cassert>
+
+// Columns per job, as for render_view
+const int column_grain = 16;
+
+void
+IndexedFramebuffer::reserve(int w, int h)
+{
+    pixels.reserve(size_t(w) * h);
+}
+
+void
+IndexedFramebuffer::resize(int w, int h)
+{
+    width = w;
+    height = h;
+    pixels.assign(size_t(w) * h, 0);
+}
+
+const IndexedImage *
+IndexedAssets::sprite(const Image &image) const
+{
+    for (auto &entry : sprites)
+    {
+        if (entry.first == image.data)
+            return &entry.second;
+    }
+    return nullptr;
+}
+
+IndexedAssets
+index_render_assets(const RenderAssets &assets, const std::vector<Image> &sprite_images)
+{
+    std::vector<Image> images = assets.walls;
+    images.push_back(assets.floor);
+    images.push_back(assets.ceiling);
+    images.insert(images.end(), sprite_images.begin(), sprite_images.end());
+
+    IndexedAssets indexed;
+    indexed.palette = build_palette(images);
+    for (const Image &image : assets.walls)
+        indexed.walls.push_back(quantize_image(indexed.palette, image));
+    indexed.floor = quantize_image(indexed.palette, assets.floor);
+    indexed.ceiling = quantize_image(indexed.palette, assets.ceiling);
+    for (const Image &image : sprite_images)
+        indexed.sprites.emplace_back(image.data, quantize_image(indexed.palette, image));
+    return indexed;
+}
+
+bool
+Colormap::matches(const RenderSettings &settings) const
+{
+    return valid &&
+           (built_for.features & ~RENDER_TRANSPARENCY) ==
+               (settings.features & ~RENDER_TRANSPARENCY) &&
+           built_for.light_dist == settings.light_dist &&
+           built_for.fog_dist == settings.fog_dist &&
+           ColorToInt(built_for.fog_color) == ColorToInt(settings.fog_color);
+}
+
+void
+Colormap::update(const Palette &palette, const RenderSettings &settings)
+{
+    if (matches(settings))
+        return;
+
+    // the bands run out where the last feature stops changing with distance
+    float max_dist = 1;
+    if (settings.features & RENDER_SHADING)
+        max_dist = std::max(max_dist, settings.light_dist);
+    if (settings.features & RENDER_FOG)
+        max_dist = std::max(max_dist, settings.fog_dist);
+    if (settings.features & RENDER_DEBUG)
+        max_dist = std::max(max_dist, settings.light_dist * 4);
+    level_scale = levels / max_dist;
+
+    jobs.parallel_for(0, levels, 4, [&](int begin, int end) {
+        for (int level = begin; level < end; level++)
+        {
+            float dist = (level + 0.5f) / level_scale;
+            uint8_t *row = table.data() + level * 256;
+            row[palette_transparent] = palette_transparent;
+            for (int i = 1; i < 256; i++)
+                row[i] = palette.nearest(tint_pixel(palette.colors[i], dist, settings));
+        }
+    });
+    built_for = settings;
+    valid = true;
+}
+
+static uint8_t
+sample_uv(const IndexedImage &img, Vector2 uv)
+{
+    int tx = int(img.width * uv.x);
+    int ty = int(img.height * uv.y);
+    return img.pixels[size_t(img.width) * ty + tx];
+}
+
+static void
+floor_columns(IndexedFramebuffer &fb, const ColumnBuffer &columns,
+              const IndexedAssets &assets, const Colormap &colormap,
+              const RenderSettings &settings, int x0, int x1)
+{
+    // rounded up so an odd height has its middle row covered, by the floor
+    int horizon = (fb.height + 1) / 2;
+    float cam_height = 0.5f * fb.height;
+    Vector2 origin = columns.origin / cell_size;
+
+    for (int x = x0; x < x1; x++)
+    {
+        Vector2 ray = { columns.ray_x[x], columns.ray_y[x] };
+        for (int y = 0; y < horizon; y += settings.floor_step)
+        {
+            float row_dist = cam_height / (horizon - y);
+            Vector2 floor_pos = origin + ray * row_dist;
+            Vector2 uv = floor_pos - Vector2 { std::floor(floor_pos.x), std::floor(floor_pos.y) };
+
+            const uint8_t *light = colormap.at(row_dist * cell_size);
+            uint8_t floor_pix = light[sample_uv(assets.floor, uv)];
+            uint8_t ceiling_pix = light[sample_uv(assets.ceiling, uv)];
+
+            int rows = std::min(settings.floor_step, horizon - y);
+            for (int k = 0; k < rows; k++)
+            {
+                fb.at(x, y + k) = ceiling_pix;
+                fb.at(x, fb.height - 1 - y - k) = floor_pix;
+            }
+        }
+    }
+}
+
+static void
+wall_columns(IndexedFramebuffer &fb, const ColumnBuffer &columns,
+             const IndexedAssets &assets, const Colormap &colormap, int x0, int x1)
+{
+    for (int x = x0; x < x1; x++)
+    {
+        float dist = columns.perp_dist[x];
+        const IndexedImage &image = assets.walls[columns.tex_id[x]];
+        float rect_h = (cell_size * fb.height) / dist;
+        float rect_y = (fb.height - rect_h) / 2;
+        int y0 = std::max(int(std::ceil(rect_y)), 0);
+        int y1 = std::min(int(std::ceil(rect_y + rect_h)), fb.height);
+        if (y0 >= y1)
+            continue;
+
+        const uint8_t *texels = image.pixels.data() + int(columns.tex_u[x] * image.width);
+        const uint8_t *light = colormap.at(dist);
+        float tex_step = image.height / rect_h;
+        float tex_y = (y0 - rect_y) * tex_step;
+
+        uint8_t *dst = &fb.at(x, y0);
+        for (int y = y0; y < y1; ++y)
+        {
+            int ty = std::min(int(tex_y), image.height - 1);
+            *dst = light[texels[ty * image.width]];
+            dst += fb.width;
+            tex_y += tex_step;
+        }
+    }
+}
+
+static void
+sprite_columns(IndexedFramebuffer &fb, const ColumnBuffer &columns, const IndexedImage &image,
+               const SpriteProjection &p, const Colormap &colormap, int x0, int x1)
+{
+    float tex_step = image.height / p.rect_h;
+    const uint8_t *light = colormap.at(p.depth);
+    for (int x = std::max(x0, p.bounds.x0); x < std::min(x1, p.bounds.x1); x++)
+    {
+        if (p.depth >= columns.perp_dist[x])
+            continue;
+
+        float u = (x - p.x_start) / (p.x_end - p.x_start);
+        int col = std::clamp(int(u * image.width), 0, image.width - 1);
+        float tex_y = (p.bounds.y0 - p.rect_y) * tex_step;
+        for (int y = p.bounds.y0; y < p.bounds.y1; y++)
+        {
+            int ty = std::min(int(tex_y), image.height - 1);
+            uint8_t texel = image.pixels[size_t(ty) * image.width + col];
+            if (texel != palette_transparent)
+                fb.at(x, y) = light[texel];
+            tex_y += tex_step;
+        }
+    }
+}
+
+void
+render_view_indexed(IndexedFramebuffer &fb,
+                    const Player &player,
+                    const ColumnBuffer &columns,
+                    const std::vector<Object> &objects,
+                    const IndexedAssets &assets,
+                    const Colormap &colormap,
+                    const RenderSettings &settings)
+{
+    int count = std::min(columns.count, fb.width);
+    {
+        PROFILE_SCOPE(Stage::FloorCeiling);
+        jobs.parallel_for(0, count, column_grain, [&](int x0, int x1) {
+            floor_columns(fb, columns, assets, colormap, settings, x0, x1);
+        });
+    }
+    {
+        PROFILE_SCOPE(Stage::Walls);
+        jobs.parallel_for(0, count, column_grain, [&](int x0, int x1) {
+            wall_columns(fb, columns, assets, colormap, x0, x1);
+        });
+    }
+    {
+        PROFILE_SCOPE(Stage::Sprites);
+        ArenaScope scope;
+        FrameVector<std::pair<const IndexedImage *, SpriteProjection>> visible;
+        visible.reserve(objects.size());
+        for (size_t i : get_render_order(player, objects))
+        {
+            const IndexedImage *image = assets.sprite(objects[i].image);
+            SpriteProjection p;
+            if (image && project_sprite(fb.width, fb.height, columns, objects[i], p))
+                visible.emplace_back(image, p);
+        }
+        jobs.parallel_for(0, count, column_grain, [&](int x0, int x1) {
+            for (auto &[image, p] : visible)
+                sprite_columns(fb, columns, *image, p, colormap, x0, x1);
+        });
+    }
+}
+
+void
+expand_framebuffer(const IndexedFramebuffer &fb, const Palette &palette, Framebuffer &out)
+{
+    assert(out.width == fb.width && out.height == fb.height && out.order == PixelOrder::Rows);
+    const int row_grain = 64;
+    jobs.parallel_for(0, fb.height, row_grain, [&](int y0, int y1) {
+        size_t begin = size_t(y0) * fb.width;
+        expand_palette(palette, fb.pixels.data() + begin, out.pixels.data() + begin,
+                       size_t(y1 - y0) * fb.width);
+    });
+}
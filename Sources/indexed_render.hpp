@@ -0,0 +1,82 @@
+#ifndef INDEXED_RENDER_HPP
+#define INDEXED_RENDER_HPP
+
+#include "palette.hpp"
+#include "raycast.hpp"
+#include "render.hpp"
+#include "world.hpp"
+#include <array>
+#include <utility>
+#include <vector>
+
+// The view at one byte per pixel: palette indices, expanded to colours only
+// when presenting. Textures are quantised to one palette at load time.
+struct IndexedFramebuffer {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+
+    // Sizes up to w x h afterwards reuse the storage, no reallocation
+    void reserve(int w, int h);
+    void resize(int w, int h);
+
+    uint8_t *row(int y) { return pixels.data() + size_t(y) * width; }
+    uint8_t &at(int x, int y) { return pixels[size_t(y) * width + x]; }
+};
+
+struct IndexedAssets {
+    Palette palette;
+    std::vector<IndexedImage> walls; // indexed by board cell value
+    IndexedImage floor;
+    IndexedImage ceiling;
+    std::vector<std::pair<const void *, IndexedImage>> sprites; // by image data
+
+    const IndexedImage *sprite(const Image &image) const;
+};
+
+// One palette for the walls, floor, ceiling and sprites
+IndexedAssets
+index_render_assets(const RenderAssets &assets, const std::vector<Image> &sprite_images);
+
+// Shading, fog and the depth debug colours as a table: for each of `levels`
+// distance bands, the palette index every palette colour turns into. The
+// passes then light a texel with one lookup.
+class Colormap
+{
+public:
+    static constexpr int levels = 64;
+
+    // Rebuilds the table when the settings it depends on changed
+    void update(const Palette &palette, const RenderSettings &settings);
+
+    const uint8_t *at(float dist) const
+    {
+        int level = std::min(int(dist * level_scale), levels - 1);
+        return table.data() + level * 256;
+    }
+
+private:
+    bool matches(const RenderSettings &settings) const;
+
+    std::array<uint8_t, levels * 256> table;
+    float level_scale = 0;
+    bool valid = false;
+    RenderSettings built_for;
+};
+
+// render_view at one byte per pixel. Sprites are cut out at half alpha,
+// there's no blending between palette colours.
+void
+render_view_indexed(IndexedFramebuffer &fb,
+                    const Player &player,
+                    const ColumnBuffer &columns,
+                    const std::vector<Object> &objects,
+                    const IndexedAssets &assets,
+                    const Colormap &colormap,
+                    const RenderSettings &settings);
+
+// Into out, which has to be as large already and in row order
+void
+expand_framebuffer(const IndexedFramebuffer &fb, const Palette &palette, Framebuffer &out);
+
+#endif // INDEXED_RENDER_HPP
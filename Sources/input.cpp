@@ -0,0 +1,127 @@
+#include "input.hpp"
+#include <cstring>
+
+namespace {
+
+const char magic[4] = { 'R', 'C', 'I', 'N' };
+const uint32_t version = 1;
+// limits on what a header may ask for, past them the file is not ours
+const uint32_t max_side = 1 << 15;
+const uint32_t max_sprites = 1 << 20;
+
+void
+put_u32(std::ostream &out, uint32_t v)
+{
+    char bytes[4] = { char(v), char(v >> 8), char(v >> 16), char(v >> 24) };
+    out.write(bytes, 4);
+}
+
+void
+put_f32(std::ostream &out, float f)
+{
+    uint32_t v;
+    std::memcpy(&v, &f, 4);
+    put_u32(out, v);
+}
+
+bool
+get_u32(std::istream &in, uint32_t &v)
+{
+    unsigned char bytes[4];
+    if (!in.read((char *) bytes, 4))
+        return false;
+    v = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | uint32_t(bytes[3]) << 24;
+    return true;
+}
+
+bool
+get_f32(std::istream &in, float &f)
+{
+    uint32_t v;
+    if (!get_u32(in, v))
+        return false;
+    std::memcpy(&f, &v, 4);
+    return true;
+}
+
+}
+
+InputFrame
+poll_input()
+{
+    InputFrame frame;
+    frame.dt = GetFrameTime();
+    frame.mouse_dx = GetMouseDelta().x;
+    frame.keys = 0;
+    if (IsKeyDown(KEY_W))       frame.keys |= INPUT_FORWARD;
+    if (IsKeyDown(KEY_S))       frame.keys |= INPUT_BACK;
+    if (IsKeyDown(KEY_A))       frame.keys |= INPUT_LEFT;
+    if (IsKeyDown(KEY_D))       frame.keys |= INPUT_RIGHT;
+    if (IsKeyPressed(KEY_T))    frame.keys |= INPUT_TOGGLE_MAP;
+    if (IsKeyPressed(KEY_SPACE)) frame.keys |= INPUT_SHOOT;
+    return frame;
+}
+
+bool
+InputRecorder::open(const std::string &path, const SceneParams &params)
+{
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+    file.write(magic, 4);
+    put_u32(file, version);
+    put_u32(file, uint32_t(params.kind));
+    put_u32(file, params.seed);
+    put_u32(file, params.width);
+    put_u32(file, params.height);
+    put_u32(file, uint32_t(params.sprites));
+    put_u32(file, uint32_t(params.backend));
+    return bool(file);
+}
+
+void
+InputRecorder::write(const InputFrame &frame)
+{
+    put_f32(file, frame.dt);
+    put_f32(file, frame.mouse_dx);
+    file.put(char(frame.keys));
+}
+
+bool
+InputPlayer::open(const std::string &path, SceneParams &params)
+{
+    file.open(path, std::ios::binary);
+    char header[4];
+    if (!file || !file.read(header, 4) || std::memcmp(header, magic, 4) != 0)
+        return false;
+
+    uint32_t v[7];
+    for (auto &value : v)
+        if (!get_u32(file, value))
+            return false;
+    if (v[0] != version)
+        return false;
+    // chunk size isn't recorded, make_board picks it
+    if (v[1] > uint32_t(SceneKind::Pillars) || v[6] > uint32_t(BoardBackend::Chunked) ||
+        v[3] == 0 || v[3] > max_side || v[4] == 0 || v[4] > max_side || v[5] > max_sprites)
+        return false;
+
+    params.kind = SceneKind(v[1]);
+    params.seed = v[2];
+    params.width = v[3];
+    params.height = v[4];
+    params.sprites = v[5];
+    params.backend = BoardBackend(v[6]);
+    return true;
+}
+
+bool
+InputPlayer::next(InputFrame &frame)
+{
+    int keys;
+    if (!get_f32(file, frame.dt) || !get_f32(file, frame.mouse_dx) ||
+        (keys = file.get()) == EOF)
+        return false;
+    frame.keys = uint8_t(keys);
+    return true;
+}
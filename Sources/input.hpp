@@ -0,0 +1,57 @@
+#ifndef INPUT_HPP
+#define INPUT_HPP
+
+#include "scene.hpp"
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+enum InputKey : uint8_t {
+    INPUT_FORWARD    = 1 << 0,
+    INPUT_BACK       = 1 << 1,
+    INPUT_LEFT       = 1 << 2,
+    INPUT_RIGHT      = 1 << 3,
+    INPUT_TOGGLE_MAP = 1 << 4, // pressed this frame
+    INPUT_SHOOT      = 1 << 5, // pressed this frame
+};
+
+// Everything the simulation reads from the outside world in one frame
+struct InputFrame {
+    float dt;
+    float mouse_dx;
+    uint8_t keys;
+
+    bool down(InputKey key) const { return keys & key; }
+};
+
+InputFrame
+poll_input();
+
+// Recording file: "RCIN", version, the scene params, then one 9 byte record
+// (dt, mouse_dx, keys) per frame. Numbers are little endian.
+class InputRecorder
+{
+public:
+    bool open(const std::string &path, const SceneParams &params);
+    void write(const InputFrame &frame);
+    bool is_open() const { return file.is_open(); }
+
+private:
+    std::ofstream file;
+};
+
+// Feeds recorded frames back. The recorded dt replaces the frame clock, so
+// the replay steps the simulation exactly as the recorded run did no matter
+// how fast it renders.
+class InputPlayer
+{
+public:
+    bool open(const std::string &path, SceneParams &params);
+    bool next(InputFrame &frame);
+    bool is_open() const { return file.is_open(); }
+
+private:
+    std::ifstream file;
+};
+
+#endif // INPUT_HPP
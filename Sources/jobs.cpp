@@ -0,0 +1,192 @@
+#include "jobs.hpp"
+#include "trace.hpp"
+#include <string>
+
+JobSystem jobs;
+
+// Queue the calling thread pushes to and pops from first. Threads outside
+// the pool are handed one of the outside queues the first time they ask.
+static thread_local int own_queue = -1;
+static std::atomic<int> next_outside_queue { 0 };
+
+static int
+queue_index()
+{
+    if (own_queue < 0)
+        own_queue = next_outside_queue.fetch_add(1) % JobSystem::outside_queues;
+    return own_queue;
+}
+
+std::vector<std::unique_ptr<JobSystem::Queue>>
+JobSystem::make_queues(int count)
+{
+    std::vector<std::unique_ptr<Queue>> result;
+    for (int i = 0; i < count; i++)
+        result.push_back(std::make_unique<Queue>());
+    return result;
+}
+
+JobSystem::~JobSystem()
+{
+    stop();
+}
+
+void
+JobSystem::start(int threads)
+{
+    stop();
+    threads = std::max(threads, 1);
+    stopping = false;
+    queues = make_queues(outside_queues + threads - 1);
+    for (int i = 1; i < threads; i++)
+        workers.emplace_back(&JobSystem::worker_loop, this, i);
+}
+
+void
+JobSystem::stop()
+{
+    if (workers.empty())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    sleep_cv.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+    workers.clear();
+    queues = make_queues(outside_queues);
+}
+
+void
+JobSystem::push(const Job &job)
+{
+    Queue &queue = *queues[queue_index()];
+    bool pushed = false;
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.count < queue_capacity)
+        {
+            queue.jobs[(queue.head + queue.count) % queue_capacity] = job;
+            queue.count++;
+            pushed = true;
+        }
+    }
+    // a full queue has plenty to keep everyone busy, run this one now
+    if (!pushed)
+    {
+        execute(job);
+        return;
+    }
+
+    queued.fetch_add(1);
+    if (sleeping.load() > 0)
+    {
+        // taking the lock orders this against a worker about to sleep
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        sleep_cv.notify_one();
+    }
+}
+
+// Newest job of our own queue, else the oldest of someone else's
+bool
+JobSystem::pop(Job &job)
+{
+    if (queued.load(std::memory_order_relaxed) == 0)
+        return false;
+
+    // outside the pool only our own, they don't run each other's jobs
+    int own = queue_index();
+    int count = int(queues.size());
+    int tries = own < outside_queues ? 1 : count;
+    for (int i = 0; i < tries; i++)
+    {
+        int index = (own + i) % count;
+        Queue &queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.count == 0)
+            continue;
+        if (i == 0)
+        {
+            job = queue.jobs[(queue.head + queue.count - 1) % queue_capacity];
+        }
+        else
+        {
+            job = queue.jobs[queue.head];
+            queue.head = (queue.head + 1) % queue_capacity;
+        }
+        queue.count--;
+        queued.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+void
+JobSystem::execute(const Job &job)
+{
+    {
+        TRACE_SCOPE("job");
+        job.fn(job.data, job.begin, job.end);
+    }
+    finish(*job.counter);
+}
+
+void
+JobSystem::finish(JobCounter &counter)
+{
+    Job released[JobCounter::max_continuations];
+    int released_count = 0;
+    {
+        std::lock_guard<std::mutex> lock(counter.mutex);
+        if (counter.pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            released_count = counter.continuation_count;
+            std::copy(counter.continuations, counter.continuations + released_count, released);
+            counter.continuation_count = 0;
+        }
+    }
+    // their own counters were raised when they were submitted
+    for (int i = 0; i < released_count; i++)
+        push(released[i]);
+}
+
+void
+JobSystem::wait(JobCounter &counter)
+{
+    Job job;
+    while (!counter.done())
+    {
+        if (pop(job))
+            execute(job);
+        else
+            std::this_thread::yield();
+    }
+    // the thread that finished the last job may still hold the lock
+    std::lock_guard<std::mutex> lock(counter.mutex);
+}
+
+void
+JobSystem::worker_loop(int index)
+{
+    own_queue = outside_queues + index - 1;
+    std::string name = "worker " + std::to_string(index);
+    trace_thread_name(name.c_str());
+
+    Job job;
+    while (true)
+    {
+        if (pop(job))
+        {
+            execute(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        sleeping.fetch_add(1);
+        sleep_cv.wait(lock, [this] { return stopping || queued.load() > 0; });
+        sleeping.fetch_sub(1);
+        if (stopping)
+            return;
+    }
+}
@@ -0,0 +1,169 @@
+#ifndef JOBS_HPP
+#define JOBS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A job calls fn(data, begin, end). The data is owned by whoever submitted
+// the job and has to outlive it, which holds as long as they wait for it.
+struct Job {
+    void (*fn)(void *data, int begin, int end);
+    void *data;
+    int begin, end;
+    class JobCounter *counter;
+};
+
+// Counts the unfinished jobs submitted with it. Jobs submitted with
+// run_after() are held by the counter they depend on and released once it
+// drops to zero. A counter can be reused once wait() returned.
+class JobCounter
+{
+public:
+    bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+    static constexpr int max_continuations = 16;
+
+    std::atomic<int> pending { 0 };
+    std::mutex mutex; // held while finishing, guards the continuations
+    Job continuations[max_continuations];
+    int continuation_count = 0;
+};
+
+// Work stealing scheduler shared by everything that wants to run in
+// parallel. Each worker owns a deque it pushes and pops at the back; idle
+// workers steal from the front of the others. Threads outside the pool (the
+// main and simulation threads) each get a deque too, and only ever run jobs
+// from their own, so the render thread never picks up simulation work.
+// Waiting on a counter runs queued jobs instead of blocking, so a thread
+// that waits is never idle and nested parallel loops can't deadlock.
+//
+// Until start() is called, or with one thread, waiting runs everything on
+// the calling thread.
+class JobSystem
+{
+public:
+    // deques for threads outside the pool; past that many they share
+    static constexpr int outside_queues = 4;
+
+    ~JobSystem();
+
+    // threads counts the caller, so threads - 1 workers are started
+    void start(int threads);
+    void stop();
+    int thread_count() const { return int(workers.size()) + 1; }
+
+    // fn(begin, end) on some thread; fn has to outlive the job
+    template <typename F>
+    void run(JobCounter &counter, F &fn, int begin = 0, int end = 0);
+
+    // Same, but not before dependency is done
+    template <typename F>
+    void run_after(JobCounter &dependency, JobCounter &counter, F &fn,
+                   int begin = 0, int end = 0);
+
+    void wait(JobCounter &counter);
+
+    // body(begin, end) over [begin, end) in chunks of about grain,
+    // returns when all of them are done
+    template <typename F>
+    void parallel_for(int begin, int end, int grain, F &&body);
+
+private:
+    static constexpr int queue_capacity = 256;
+
+    struct Queue {
+        std::mutex mutex;
+        Job jobs[queue_capacity];
+        int head = 0;
+        int count = 0;
+    };
+
+    template <typename F>
+    static void call(void *data, int begin, int end)
+    {
+        (*static_cast<F *>(data))(begin, end);
+    }
+
+    template <typename F>
+    static Job make_job(JobCounter &counter, F &fn, int begin, int end)
+    {
+        return { &call<F>, const_cast<void *>(static_cast<const void *>(&fn)),
+                 begin, end, &counter };
+    }
+
+    void push(const Job &job);
+    bool pop(Job &job);
+    void execute(const Job &job);
+    void finish(JobCounter &counter);
+    void worker_loop(int index);
+
+    // the first outside_queues are for threads outside the pool, workers
+    // own the rest
+    std::vector<std::unique_ptr<Queue>> queues = make_queues(outside_queues);
+    std::vector<std::thread> workers;
+    std::atomic<int> queued { 0 };
+    std::atomic<int> sleeping { 0 };
+    bool stopping = false;
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_cv;
+
+    static std::vector<std::unique_ptr<Queue>> make_queues(int count);
+};
+
+extern JobSystem jobs;
+
+template <typename F>
+void
+JobSystem::run(JobCounter &counter, F &fn, int begin, int end)
+{
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+    push(make_job(counter, fn, begin, end));
+}
+
+template <typename F>
+void
+JobSystem::run_after(JobCounter &dependency, JobCounter &counter, F &fn, int begin, int end)
+{
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+    Job job = make_job(counter, fn, begin, end);
+    {
+        std::lock_guard<std::mutex> lock(dependency.mutex);
+        if (!dependency.done() &&
+            dependency.continuation_count < JobCounter::max_continuations)
+        {
+            dependency.continuations[dependency.continuation_count++] = job;
+            return;
+        }
+    }
+    if (!dependency.done())
+        wait(dependency);
+    push(job);
+}
+
+template <typename F>
+void
+JobSystem::parallel_for(int begin, int end, int grain, F &&body)
+{
+    if (begin >= end)
+        return;
+    grain = std::max(grain, 1);
+    if (workers.empty() || end - begin <= grain)
+    {
+        body(begin, end);
+        return;
+    }
+
+    JobCounter counter;
+    for (int chunk = begin; chunk < end; chunk += grain)
+        run(counter, body, chunk, std::min(chunk + grain, end));
+    wait(counter);
+}
+
+#endif // JOBS_HPP
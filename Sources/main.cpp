@@ -6,194 +6,60 @@
 #include <iostream>
 #include <cmath>
 #include <chrono>
-#include <unordered_map>
-#include <unordered_set>
-
-#define DRAW_VIEW_RAYS
-#define DRAW_COLLISIONS
-// #define USE_SHADING
-// #define DRAW_RAYS_TO_OBJECTS
+#include <memory>
+#include <string>
+#include <thread>
+#include "alloc_counter.hpp"
+#include "board.hpp"
+#include "debug_draw.hpp"
+#include "frame_cache.hpp"
+#include "gpu_view.hpp"
+#include "indexed_render.hpp"
+#include "input.hpp"
+#include "jobs.hpp"
+#include "post_process.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
+#include "raycast.hpp"
+#include "render.hpp"
+#include "resolution.hpp"
+#include "scene.hpp"
+#include "simulation.hpp"
+#include "visibility.hpp"
+#include "world.hpp"
 
 const int screen_width = 1024;
 const int screen_height = 768;
 const float mouse_sensetivity = 3;
-
-const int board_w = 8;
-const int board_h = 9;
-
-const int cell_size = 80;
-
-int board[board_w][board_h] = {
-    { 1, 1, 1, 1, 1, 1, 1, 1, 1 },
-    { 1, 0, 0, 0, 0, 0, 0, 0, 1 },
-    { 1, 0, 2, 0, 0, 0, 1, 0, 1 },
-    { 1, 2, 2, 0, 0, 0, 0, 0, 1 },
-    { 1, 0, 0, 0, 0, 0, 0, 0, 1 },
-    { 1, 0, 0, 0, 0, 0, 0, 0, 1 },
-    { 1, 0, 1, 0, 0, 0, 0, 0, 1 },
-    { 1, 1, 1, 1, 1, 1, 1, 1, 1 },
-};
-
-Image images[] = {
-    LoadImage("./Assets/textures/TECH_1A.png"), // NULL
-    LoadImage("./Assets/textures/TECH_1A.png"),
-    LoadImage("./Assets/textures/SUPPORT_3.png"),
-};
-
-Image floor_img = LoadImage("./Assets/textures/FLOOR_1A.png");
-Image ceiling_img = LoadImage("./Assets/textures/LIGHT_1C.png");
-
-struct Player {
-    Vector2 pos;
-    float rotation;
-    float speed;
-};
-
-struct Object {
-    size_t id;
-    Vector2 pos;
-    Image image;
-
-    Object()
-    {
-        static size_t counter = 0;
-        id = counter++;
-    }
-};
-
-struct CellPos {
-    int x, y;
-    CellPos() : x(0), y(0) {};
-    CellPos(int x, int y) : x(x), y(y) {};
-    CellPos(Vector2 v) : x(int(v.x)), y(int(v.y)) {};
-    bool operator==(const CellPos &p) const
-    {
-        return p.x == x && p.y == y;
-    }
-    bool operator!=(const CellPos &p) const
-    {
-        return p.x != x || p.y != y;
-    }
-
-};
-
-std::ostream &operator<<(std::ostream &stream, const CellPos &c)
-{
-    stream << c.x << ' ' << c.y;
-    return stream;
-}
-
-struct hash_fn
-{
-    std::size_t operator() (const CellPos &p) const
-    {
-        std::size_t h1 = std::hash<int>()(p.x);
-        std::size_t h2 = std::hash<int>()(p.y);
-        return h1 ^ h2;
-    }
-};
-
-struct RayHit {
-    Vector2 pos;
-    CellPos cell_pos;
-    bool is_horizontal;
-    float angle;
-};
-
-struct Collision {
-    Vector2 pos;
-    CellPos cell;
-};
+// shooting tints the view for a moment
+const Color muzzle_flash = { 255, 200, 120, 96 };
+const float muzzle_flash_time = 0.1f;
 
 struct RaycastConfig
 {
     float fov;
     int rays_count;
     float delta_angle;
-    float rect_w;
+    int wall_span; // widest span cast_view fills without casting
+    bool wall_segments; // walls from the visible cell walk, not rays
     RenderTexture minimap;
+    RenderTexture minimap_cells; // static layer, redrawn when the board changes
+    bool minimap_cells_valid;
+    uint64_t minimap_revision;
     bool draw_map;
 };
 
 RaycastConfig config;
 
-inline Vector2
-get_cell(const Vector2 &pos)
-{
-    return Vector2 {
-        std::floor(pos.x / cell_size),
-        std::floor(pos.y / cell_size),
-    };
-}
-
-inline bool
-correct_cell(int x, int y)
-{
-    return (x >= 0 && x < board_w) && (y >= 0 && y < board_h);
-}
-
-inline bool
-correct_cell(CellPos pos)
-{
-    return correct_cell(pos.x, pos.y);
-}
-
-inline float
-fix_angle(float angle)
-{
-    while (angle > PI)  angle -= 2 * PI;
-    while (angle < -PI) angle += 2 * PI;
-    return angle;
-}
-
-std::vector<Collision>
-find_collisions(const Vector2 &pos, float radius)
-{
-    float radius_sqr = radius * radius;
-    std::vector<Collision> collisions;
-    CellPos cell = CellPos(get_cell(pos));
-
-    for (int i = -1; i <= 1; i++)
-    {
-        for (int j = -1; j <= 1; j++)
-        {
-            if (i == 0 && j == 0) continue;
-            CellPos neighbour(cell.x + i, cell.y + j);
-            if (!correct_cell(neighbour)) continue;
-            if (board[neighbour.x][neighbour.y] == 0) continue;
-
-            Vector2 collision = pos;
-            if (neighbour.x < cell.x)
-                collision.x = cell.x * 1.0f * cell_size;
-            else if (neighbour.x > cell.x)
-                collision.x = cell.x * 1.0f * cell_size + cell_size;
-
-            if (neighbour.y < cell.y)
-                collision.y = cell.y * 1.0f * cell_size;
-            else if (neighbour.y > cell.y)
-                collision.y = cell.y * 1.0f * cell_size + cell_size;
-
-            if (Vector2LengthSqr(collision - pos) <= radius_sqr)
-            {
-                collisions.push_back(Collision {
-                    collision,
-                    neighbour,
-                });
-            }
-        }
-    }
-
-    return collisions;
-}
-
+// Into the current render target
 void
-draw_top_down_view(const Player &player,
-                   const std::vector<RayHit> &hits,
-                   const std::vector<Object> &objects)
+draw_map_cells(const Board &board)
 {
-    for (int row = 0; row < board_h; ++row) {
-        for (int col = 0; col < board_w; ++col) {
-            if (board[col][row] != 0) {
+    int rows = std::min(board.height(), screen_height / cell_size + 1);
+    int cols = std::min(board.width(), screen_width / cell_size + 1);
+    for (int row = 0; row < rows; ++row) {
+        for (int col = 0; col < cols; ++col) {
+            if (board.at(col, row) != 0) {
                 DrawRectangle(col * cell_size, row * cell_size,
                     cell_size, cell_size, BLACK);
             }
@@ -211,13 +77,33 @@ draw_top_down_view(const Player &player,
     for (int y = cell_size; y < screen_height; y += cell_size) {
         DrawLine(0, y, screen_width, y, GRAY);
     }
+}
+
+void
+update_map_cells(const Board &board, uint64_t revision)
+{
+    if (config.minimap_cells_valid && config.minimap_revision == revision)
+        return;
+    BeginTextureMode(config.minimap_cells);
+    ClearBackground(BLANK);
+    draw_map_cells(board);
+    EndTextureMode();
+    config.minimap_cells_valid = true;
+    config.minimap_revision = revision;
+}
+
+// The cached cells with the moving parts over them, into the current
+// render target
+void
+draw_top_down_view(const Player &player, const std::vector<Object> &objects)
+{
+    // a render texture is stored upside down, the negative height copies
+    // it the way it was drawn
+    Texture2D cells = config.minimap_cells.texture;
+    DrawTextureRec(cells, { 0, 0, float(cells.width), -float(cells.height) }, { 0, 0 }, WHITE);
 
     Vector2 player_cell = get_cell(player.pos);
     DrawRectangleV(player_cell * cell_size, {cell_size, cell_size}, PURPLE);
-#ifdef DRAW_VIEW_RAYS
-    for (auto &hit : hits)
-        DrawLineEx(player.pos, hit.pos, 2, BLUE);
-#endif
     for (auto &object : objects)
     {
         Vector2 player_to_object = object.pos - player.pos;
@@ -233,284 +119,44 @@ draw_top_down_view(const Player &player,
 }
 
 
-RayHit
-cast_ray(Vector2 pos, Vector2 dir)
-{
-    float angle = Vector2Angle({1, 0}, dir);
-    Vector2 cell = pos / cell_size;
-
-    RayHit hit_h;
-    hit_h.angle = angle;
-    hit_h.is_horizontal = true;
-
-    float hor_mag = (std::round((dir.y < 0 ? -0.5 : 0.5) + cell.y) - cell.y) / dir.y * cell_size;
-    float hor_move = std::abs(cell_size / dir.y);
-    hit_h.pos = pos + dir * hor_mag;
-
-    for (int k = 0; ; ++k) {
-        hit_h.cell_pos.x = int(hit_h.pos.x / cell_size);
-        hit_h.cell_pos.y = int((hit_h.pos.y + dir.y * 0.5f * cell_size) / cell_size);
-        bool correct = correct_cell(hit_h.cell_pos);
-        if (!correct) break;
-        bool is_wall = board[hit_h.cell_pos.x][hit_h.cell_pos.y] != 0;
-        if (correct && is_wall) break;
-        hit_h.pos += dir * hor_move;
-    }
-
-    RayHit hit_v;
-    hit_v.angle = angle;
-    hit_v.is_horizontal = false;
-
-    float vert_mag = (std::round((dir.x < 0 ? -0.5 : 0.5) + cell.x) - cell.x) / dir.x * cell_size;
-    float vert_move = std::abs(cell_size / dir.x);
-    hit_v.pos = pos + dir * vert_mag;
-
-    for (int k = 0; ; ++k) {
-        hit_v.cell_pos.x = int((hit_v.pos.x + dir.x * 0.5f * cell_size) / cell_size);
-        hit_v.cell_pos.y = int(hit_v.pos.y / cell_size);
-        bool correct = correct_cell(hit_v.cell_pos);
-        if (!correct) break;
-        bool is_wall = board[hit_v.cell_pos.x][hit_v.cell_pos.y] != 0;
-        if (correct && is_wall) break;
-        hit_v.pos += dir * vert_move;
-    }
-
-    if (Vector2LengthSqr(hit_h.pos - pos) < Vector2LengthSqr(hit_v.pos - pos))
-        return hit_h;
-    else
-        return hit_v;
-}
-
-Vector2
-slerp(Vector2 a, Vector2 b, float t)
-{
-    float omega = std::acos(Vector2DotProduct(Vector2Normalize(a), Vector2Normalize(b)));
-    float k1 = std::sin((1 - t) * omega) / std::sin(omega);
-    float k2 = std::sin(t * omega) / std::sin(omega);
-    return a * k1 + b * k2;
-}
-
-Color
-sample_uv(const Image &img, const Vector2 uv)
-{
-    int tx = int(img.width * uv.x);
-    int ty = int(img.height * uv.y);
-    Color *color_data = (Color *) img.data;
-    return color_data[img.width * ty + tx];
-}
-
-std::vector<size_t>
-get_render_order(const Player &player, const std::vector<Object> &objects)
+void
+draw_view_rays(const Player &player, const ColumnBuffer &columns, DebugDraw &debug)
 {
-    std::vector<std::pair<float, size_t>> distances;
-    for (size_t i = 0; i < objects.size(); i++)
+    if (!debug_enabled(DebugCategory::ViewRays))
+        return;
+    for (int x = 0; x < columns.count; x++)
     {
-        float dist = Vector2LengthSqr(objects[i].pos - player.pos);
-        distances.emplace_back(dist, i);
+        // extract_view leaves columns no wall covers at infinity
+        if (std::isfinite(columns.perp_dist[x]))
+            debug.line(DebugCategory::ViewRays, player.pos, columns.hit_pos(x), 2, BLUE);
     }
-    std::sort(distances.begin(), distances.end(), std::greater<>());
-
-    std::vector<size_t> order;
-    for (auto &p : distances)
-        order.push_back(p.second);
-    return order;
-}
-
-Color
-blend_colors(Color c1, Color c2, float val)
-{
-    Color blend = (c1 * (1.0f - val) + c2 * val);
-    blend.a = c1.a;
-    return blend;
 }
 
 void
-draw_raycast_view(const Player &player,
-                  const std::vector<RayHit> &hits,
-                  const std::vector<Object> &objects,
-                  const RaycastConfig &config)
+draw_rays_to_objects(const Player &player, const std::vector<Object> &objects,
+                     DebugDraw &debug)
 {
-    int horizon = screen_height / 2.0f;
-    float cam_height = 0.5f * screen_height;
-    float light_dist = 200.0f;
-
-    float rect_x = 0;
-    for (auto &hit : hits)
-    {
-        float floor_pix_h = 3;
-        Vector2 hit_delta = hit.pos - player.pos;
-        float dist =
-            hit_delta.x * cos(player.rotation) +
-            hit_delta.y * sin(player.rotation);
-
-        // floor and ceiling
-        Vector2 ray0 = Vector2Normalize(hit_delta);
-        float angle = fix_angle(hit.angle - player.rotation + config.fov / 2.0);
-        int x = int(angle / config.fov * screen_width);
-        float floor_dist = dist / Vector2Length(hit_delta);
-        for(int y = 0; y < horizon; y += floor_pix_h)
-        {
-            float row_dist = cam_height / (horizon - y) / floor_dist;
-            Vector2 floor_pos = player.pos / cell_size + ray0 * row_dist;
-            Vector2 cell = Vector2 {
-                std::floor(floor_pos.x),
-                std::floor(floor_pos.y),
-            };
-            Vector2 uv = floor_pos - cell;
-
-            Color floor_pix = sample_uv(floor_img, uv);
-            Color ceiling_pix = sample_uv(ceiling_img, uv);
-
-#ifdef USE_SHADING
-            float blend = row_dist * cell_size / light_dist;
-            blend *= blend;
-            if (blend > 1.0f) blend = 1.0f;
-            floor_pix = blend_colors(floor_pix, BLACK, blend);
-            ceiling_pix = blend_colors(ceiling_pix, BLACK, blend);
-#endif
-
-            DrawRectangle(
-                x, screen_height - y,
-                config.rect_w + 1, floor_pix_h,
-                floor_pix
-            );
-            DrawRectangle(
-                x, y,
-                config.rect_w + 1, floor_pix_h,
-                ceiling_pix
-            );
-        }
-
-        // walls
-        float rect_h = (cell_size * screen_height) / dist;
-        float rect_y = (screen_height - rect_h) / 2;
-
-        int image_idx = board[hit.cell_pos.x][hit.cell_pos.y];
-
-        Vector2 pos_in_cell = {
-            hit.pos.x - hit.cell_pos.x * cell_size,
-            hit.pos.y - hit.cell_pos.y * cell_size,
-        };
-        Image cell_image = images[image_idx];
-        Vector2 column = pos_in_cell / cell_size * cell_image.width;
-        int col = column.y;
-        if (hit.is_horizontal)
-            col = column.x;
-
-        float wall_pix_h = rect_h / cell_image.height;
-        for (int i = 0; i < cell_image.height; ++i)
-        {
-            Color* color_data = (Color*)cell_image.data;
-            Color pixel = color_data[i * cell_image.width + col];
-
-#ifdef USE_SHADING
-            float blend = dist / light_dist;
-            blend *= blend;
-            if (blend > 1.0f) blend = 1.0f;
-            pixel = blend_colors(pixel, BLACK, blend);
-#endif
-
-            DrawRectangle(
-                rect_x - 1, rect_y + wall_pix_h * i,
-                config.rect_w + 2, std::ceil(wall_pix_h),
-                pixel
-            );
-        }
-
-        rect_x += config.rect_w;
-    }
-
-    std::vector<size_t> render_order = get_render_order(player, objects);
-    for (size_t i : render_order)
+    if (!debug_enabled(DebugCategory::SpriteRays))
+        return;
+    for (auto &object : objects)
     {
-        const Object &object = objects[i];
         Vector2 player_to_object = object.pos - player.pos;
         Vector2 anti_normal = Vector2Normalize(Vector2Rotate(player_to_object, 90 * DEG2RAD));
 
         Vector2 a = object.pos - anti_normal * cell_size / 2;
         Vector2 b = object.pos + anti_normal * cell_size / 2;
-
-        Vector2 dir = Vector2Rotate({ 1, 0 }, player.rotation);
-
-        float start_angle = fix_angle(Vector2Angle({1, 0}, a - player.pos));
-        float end_angle = fix_angle(Vector2Angle({1, 0}, b - player.pos));
-
-        const float fov = std::abs(end_angle - start_angle);
-        const int rays_count = fov / config.fov * config.rays_count;
-
-        for (int ray_i = 0; ray_i < rays_count; ray_i++)
-        {
-            Vector2 point = player.pos + slerp(a - player.pos, b - player.pos, ray_i * 1.0f / rays_count);
-            RayHit hit = cast_ray(player.pos, Vector2Normalize(point - player.pos));
-
-            auto point_delta = point - player.pos;
-            float dist = Vector2Length(point_delta);
-            if (dist < Vector2Length(hit.pos - player.pos))
-            {
-#ifdef DRAW_RAYS_TO_OBJECTS
-                BeginTextureMode(config.minimap);
-                DrawLineV(player.pos, point, GREEN);
-                EndTextureMode();
-#endif
-
-                float rect_h = (cell_size * screen_height) / dist;
-                float rect_y = (screen_height - rect_h) / 2;
-
-                float rect_xa = fix_angle(Vector2Angle(Vector2Rotate(dir, -config.fov / 2), a - player.pos)) / config.fov * screen_width;
-                float rect_xb = fix_angle(Vector2Angle(Vector2Rotate(dir, -config.fov / 2), b - player.pos)) / config.fov * screen_width;
-                float rect_w = std::abs(rect_xb - rect_xa) / rays_count;
-
-                rect_x = fix_angle(Vector2Angle(Vector2Rotate(dir, -config.fov / 2), point - player.pos)) / config.fov * screen_width;
-                if (rect_x + rect_w < 0) continue;
-                if (rect_x < 0) rect_x = 0;
-
-                float pix_h = rect_h / object.image.height;
-                float column = (ray_i * 1.0f / rays_count) * object.image.width;
-                int col = (int) column;
-
-                for (int i = 0; i < object.image.height; ++i)
-                {
-                    Color* color_data = (Color*)object.image.data;
-                    Color pixel = color_data[i * object.image.width + col];
-
-#ifdef USE_SHADING
-                    float blend = dist / light_dist;
-                    blend *= blend;
-                    if (blend > 1.0f) blend = 1.0f;
-                    pixel = blend_colors(pixel, BLACK, blend);
-#endif
-
-                    DrawRectangle(
-                        rect_x, rect_y + pix_h * i,
-                        rect_w + 1, std::ceil(pix_h),
-                        pixel
-                    );
-                }
-            }
-#ifdef DRAW_RAYS_TO_OBJECTS
-            else
-            {
-                BeginTextureMode(config.minimap);
-                DrawLineEx(player.pos, hit.pos, 2, MAGENTA);
-                EndTextureMode();
-            }
-#endif
-        }
-#ifdef DRAW_RAYS_TO_OBJECTS
-        BeginTextureMode(config.minimap);
-        DrawLineEx(player.pos, a, 5, BLACK);
-        DrawLineEx(player.pos, b, 5, PURPLE);
-        EndTextureMode();
-#endif
+        debug.line(DebugCategory::SpriteRays, player.pos, a, 5, BLACK);
+        debug.line(DebugCategory::SpriteRays, player.pos, b, 5, PURPLE);
     }
 }
 
 void
-fix_collisions(Player &player, const Vector2 &move_dir, float dt)
+fix_collisions(const Board &board, Player &player, const Vector2 &move_dir, float dt,
+               DebugDraw &debug)
 {
     const int collision_radius = 25;
     Vector2 move = move_dir * (player.speed * dt);
-    std::vector<Collision> collisions = find_collisions(player.pos + move, collision_radius);
+    FrameVector<Collision> collisions = find_collisions(board, player.pos + move, collision_radius);
     player.pos += move;
     if (!collisions.empty())
     {
@@ -520,86 +166,20 @@ fix_collisions(Player &player, const Vector2 &move_dir, float dt)
                 continue;
             Vector2 fix = Vector2Normalize(player.pos - collision.pos) * collision_radius + collision.pos;
             player.pos += fix - player.pos;
-#ifdef DRAW_COLLISIONS
-            BeginTextureMode(config.minimap);
-                DrawRectangle(
-                    collision.cell.x * cell_size,
-                    collision.cell.y * cell_size,
-                    cell_size, cell_size, GREEN
-                );
-                DrawCircleV(collision.pos, 4, MAGENTA);
-                DrawCircleV(fix, 4, MAGENTA);
-            EndTextureMode();
-#endif
+            Vector2 cell = { collision.cell.x * 1.0f * cell_size,
+                             collision.cell.y * 1.0f * cell_size };
+            debug.rect(DebugCategory::Collisions, cell, { cell_size, cell_size }, GREEN);
+            debug.circle(DebugCategory::Collisions, collision.pos, 4, MAGENTA);
+            debug.circle(DebugCategory::Collisions, fix, 4, MAGENTA);
         }
     }
 }
 
-std::vector<CellPos>
-find_path(Vector2 from, Vector2 to)
+void
+draw_path(const std::vector<CellPos> &path, DebugDraw &debug)
 {
-    CellPos cell0(from / cell_size);
-    CellPos cell_fin(to / cell_size);
-
-    std::unordered_set<CellPos, hash_fn> visited;
-    std::unordered_map<CellPos, CellPos, hash_fn> trace;
-    std::unordered_set<CellPos, hash_fn> front = { cell0 };
-
-    CellPos prev = cell0;
-    bool found = false;
-    while (!found)
-    {
-        CellPos cur;
-        int heuristic = INT_MAX;
-        for (auto &cell : front)
-        {
-            int h = std::abs(cell.x - cell_fin.x) + std::abs(cell.y - cell_fin.y);
-            if (h < heuristic)
-            {
-                heuristic = h;
-                cur = cell;
-            }
-        }
-
-        front.erase(cur);
-        visited.insert(cur);
-        prev = cur;
-
-        std::vector<CellPos> neighbours;
-        neighbours.emplace_back(cur.x - 1, cur.y);
-        neighbours.emplace_back(cur.x + 1, cur.y);
-        neighbours.emplace_back(cur.x, cur.y - 1);
-        neighbours.emplace_back(cur.x, cur.y + 1);
-
-        for (auto &neighbour : neighbours)
-        {
-            if (neighbour == cell_fin)
-            {
-                trace[neighbour] = cur;
-                found = true;
-                break;
-            }
-            else if (correct_cell(neighbour) &&
-                     board[neighbour.x][neighbour.y] == 0 &&
-                     visited.find(neighbour) == visited.end())
-            {
-                front.insert(neighbour);
-                trace[neighbour] = cur;
-            }
-        }
-    }
-
-    // TODO: check if there is no path
-    std::vector<CellPos> path;
-    CellPos tracer = cell_fin;
-    while (tracer != cell0)
-    {
-        path.push_back(tracer);
-        tracer = trace.at(tracer);
-    }
-    path.push_back(cell0);
-
-    BeginTextureMode(config.minimap);
+    if (!debug_enabled(DebugCategory::Paths))
+        return;
     for (int i = 0; i < int(path.size()) - 1; i++)
     {
         CellPos c0 = path[i];
@@ -612,11 +192,65 @@ find_path(Vector2 from, Vector2 to)
             c1.x * 1.0f * cell_size + cell_size / 2.0f,
             c1.y * 1.0f * cell_size + cell_size / 2.0f,
         };
-        DrawLineEx(p0, p1, 10, MAGENTA);
+        debug.line(DebugCategory::Paths, p0, p1, 10, MAGENTA);
     }
-    EndTextureMode();
-    std::reverse(path.begin(), path.end());
-    return path;
+}
+
+// The first objects after the barrel chase the player. Each agent only
+// touches its own object and path, so they can move in parallel.
+const int agent_count = 2;
+
+void
+move_agent(const Board &board, WorldState &world, int agent, int stage,
+           std::vector<CellPos> &path, float dt, DebugDraw &debug)
+{
+    const float agent_speeds[] = { 30, 40 };
+    std::vector<Object> &objects = world.objects;
+    if (size_t(agent) >= objects.size())
+        return;
+
+    PROFILE_SCOPE(Stage::Pathfinding);
+    PROFILE_SCOPE(stage);
+    find_path(board, objects[agent].pos, world.player.pos, path);
+    draw_path(path, debug);
+    if (path.size() > 1)
+    {
+        CellPos c0 = path[1];
+        Vector2 p0 = {
+            c0.x * 1.0f * cell_size + cell_size / 2.0f,
+            c0.y * 1.0f * cell_size + cell_size / 2.0f,
+        };
+
+        Vector2 move = Vector2Normalize(p0 - objects[agent].pos) * dt * agent_speeds[agent - 1];
+        objects[agent].pos += move;
+    }
+}
+
+// F1, F2, ... toggle the debug categories, F5 on the render features;
+// the ones on are lit
+void
+draw_debug_legend(int x, int y, uint8_t features)
+{
+    for (int i = 0; i < int(DebugCategory::Count); i++)
+    {
+        DebugCategory category = DebugCategory(i);
+        Color color = debug_enabled(category) ? LIME : GRAY;
+        DrawText(TextFormat("F%d %s", i + 1, debug_category_name(category)),
+                 x, y + 30 * i, 20, color);
+    }
+    for (int i = 0; (1 << i) < RENDER_FEATURE_COMBINATIONS; i++)
+    {
+        Color color = features & (1 << i) ? LIME : GRAY;
+        DrawText(TextFormat("F%d %s", i + 5, render_feature_name(RenderFeature(1 << i))),
+                 x + 200, y + 30 * i, 20, color);
+    }
+}
+
+// Shared by the simulation and the view so both end up at the same angle
+void
+turn(Player &player, const InputFrame &input)
+{
+    player.rotation += input.mouse_dx * 1e-3f * mouse_sensetivity;
 }
 
 void
@@ -687,129 +321,490 @@ draw_crosshair()
     );
 }
 
-int main()
+int main(int argc, char **argv)
 {
-    InitWindow(screen_width, screen_height, "Raycaster");
-    // SetTargetFPS(60);
-    Texture2D hands = LoadTexture("./Assets/textures/hands.png");
-
-    Player player;
-    player.pos = { 5.0f * cell_size, 5.0f * cell_size };
-    player.speed = 150;
-    player.rotation = 0;
+    SceneParams params;
+    std::string record_path, replay_path, profile_path, trace_path;
+    int trace_frames = 120;
+    bool perf_counters = false;
+    float target_ms = 0;
+    float sim_hz = 60;
+    bool sim_thread = true;
+    int threads = std::max(int(std::thread::hardware_concurrency()), 1);
+    bool wall_segments = false;
+    bool gpu_view = false;
+    bool indexed = false;
+    bool column_major = false;
+    int upscale = 0;
+    float gamma = 1;
+    float brightness = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--board" && has_value)
+        {
+            if (!parse_board_backend(argv[++i], params.backend))
+            {
+                std::cerr << "unknown board backend: " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--scene" && has_value)
+        {
+            if (!parse_scene_kind(argv[++i], params.kind))
+            {
+                std::cerr << "unknown scene: " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--seed" && has_value)
+            params.seed = std::stoul(argv[++i]);
+        else if (arg == "--size" && has_value)
+            params.width = params.height = std::stoi(argv[++i]);
+        else if (arg == "--sprites" && has_value)
+            params.sprites = std::stoul(argv[++i]);
+        else if (arg == "--record" && has_value)
+            record_path = argv[++i];
+        else if (arg == "--replay" && has_value)
+            replay_path = argv[++i];
+        else if (arg == "--profile-csv" && has_value)
+            profile_path = argv[++i];
+        else if (arg == "--target-ms" && has_value)
+            target_ms = std::stof(argv[++i]);
+        else if (arg == "--sim-hz" && has_value)
+            sim_hz = std::max(std::stof(argv[++i]), 1.0f);
+        else if (arg == "--threads" && has_value)
+            threads = std::max(std::stoi(argv[++i]), 1);
+        else if (arg == "--no-sim-thread")
+            sim_thread = false;
+        else if (arg == "--wall-segments")
+            wall_segments = true;
+        else if (arg == "--gpu-view")
+            gpu_view = true;
+        else if (arg == "--indexed")
+            indexed = true;
+        else if (arg == "--column-major")
+            column_major = true;
+        else if (arg == "--upscale" && has_value)
+            upscale = std::max(std::stoi(argv[++i]), 1);
+        else if (arg == "--gamma" && has_value)
+            gamma = std::stof(argv[++i]);
+        else if (arg == "--brightness" && has_value)
+            brightness = std::stof(argv[++i]);
+        else if (arg == "--perf-counters")
+            perf_counters = true;
+        else if (arg == "--trace" && has_value)
+            trace_path = argv[++i];
+        else if (arg == "--trace-frames" && has_value)
+            trace_frames = std::stoi(argv[++i]);
+        else
+        {
+            std::cerr << "usage: raycaster [--board dense|quadtree|chunked]"
+                         " [--scene room|maze|arena|corridors|pillars]"
+                         " [--seed N] [--size N] [--sprites N]"
+                         " [--record FILE | --replay FILE]"
+                         " [--profile-csv FILE] [--perf-counters]"
+                         " [--trace FILE] [--trace-frames N]"
+                         " [--target-ms MS] [--wall-segments] [--gpu-view] [--indexed]"
+                         " [--column-major] [--upscale N] [--gamma G] [--brightness B]"
+                         " [--sim-hz N] [--no-sim-thread] [--threads N]" << std::endl;
+            return 1;
+        }
+    }
 
-    std::vector<Object> objects;
+    // a replay brings its own scene
+    InputRecorder recorder;
+    InputPlayer replay;
+    if (!replay_path.empty() && !replay.open(replay_path, params))
+    {
+        std::cerr << "can't replay " << replay_path << std::endl;
+        return 1;
+    }
+    if (!record_path.empty() && !recorder.open(record_path, params))
+    {
+        std::cerr << "can't record to " << record_path << std::endl;
+        return 1;
+    }
 
-    Object barrel;
-    barrel.pos = { 3 * cell_size, 5 * cell_size };
-    barrel.image = LoadImage("./Assets/textures/barrel.png");
-    objects.push_back(barrel);
+    // asset loading, rendering and the agents share one pool of workers
+    jobs.start(threads);
 
-    Object barrel2;
-    barrel2.pos = { 3 * cell_size, 4 * cell_size };
-    barrel2.image = LoadImage("./Assets/textures/enemy1.png");
-    objects.push_back(barrel2);
+    InitWindow(screen_width, screen_height, "Raycaster");
+    // SetTargetFPS(60);
+    Texture2D hands = LoadTexture("./Assets/textures/hands.png");
 
-    Object barrel3;
-    barrel3.pos = { 2 * cell_size, 2 * cell_size };
-    barrel3.image = LoadImage("./Assets/textures/michael.png");
-    objects.push_back(barrel3);
+    std::vector<Image> sprite_images = {
+        LoadImage("./Assets/textures/barrel.png"),
+        LoadImage("./Assets/textures/enemy1.png"),
+        LoadImage("./Assets/textures/michael.png"),
+    };
+    RenderAssets assets = load_render_assets("./Assets/textures");
+    // --gpu-view draws the view as textured quads instead of a CPU frame
+    ViewTextures view_textures;
+    if (gpu_view)
+        view_textures = upload_view_textures(assets, sprite_images);
+    // --indexed renders palette indices and expands them when presenting
+    IndexedAssets indexed_assets;
+    if (indexed)
+        indexed_assets = index_render_assets(assets, sprite_images);
+    Scene scene = generate_scene(params, sprite_images);
+    std::unique_ptr<Board> board = std::move(scene.board);
+
+    // The simulation runs in fixed steps; frames show `view`, the state
+    // between the last two steps that matches the time of the frame.
+    WorldState view { scene.player, std::move(scene.objects) };
 
     config.fov = 75 * DEG2RAD;
-    config.rays_count = screen_width / 4;
+    // --upscale N renders at 1/N of the window both ways, else a column
+    // is 4 pixels wide and the view full height
+    config.rays_count = screen_width / (upscale > 0 ? upscale : 4);
+    int view_height = upscale > 0 ? screen_height / upscale : screen_height;
     config.delta_angle = config.fov / config.rays_count;
-    config.rect_w = (screen_width / config.fov) * config.delta_angle;
+    config.wall_span = 16;
+    config.wall_segments = wall_segments;
     config.minimap = LoadRenderTexture(screen_width, screen_height);
+    config.minimap_cells = LoadRenderTexture(screen_width, screen_height);
+    config.minimap_cells_valid = false;
     config.draw_map = false;
 
-    while (!WindowShouldClose())
+    RenderSettings settings;
+    settings.fov = config.fov;
+
+    // Adaptive resolution shrinks the frame below rays_count columns; the
+    // buffers and the texture keep their full size so that costs nothing.
+    ResolutionSettings resolution_settings;
+    resolution_settings.target_ms = target_ms;
+    resolution_settings.base_floor_step = settings.floor_step;
+    ResolutionController resolution(resolution_settings, config.rays_count);
+
+    Framebuffer frame;
+    // the indexed path expands into the frame row by row
+    if (column_major && !indexed)
+        frame.order = PixelOrder::Columns;
+    frame.reserve(config.rays_count, view_height);
+    frame.resize(config.rays_count, view_height);
+    IndexedFramebuffer indexed_frame;
+    indexed_frame.reserve(config.rays_count, view_height);
+    indexed_frame.resize(config.rays_count, view_height);
+    Colormap colormap;
+    ColumnBuffer columns;
+    columns.reserve(config.rays_count);
+    FrameCache frame_cache;
+    DebugDraw frame_debug; // the main thread's, shown on the next frame's minimap
+    // the frame after the post stage, whole multiples of it up to the window
+    PostSettings post;
+    post.lut.build(gamma, brightness);
+    Framebuffer post_frame;
+    post_frame.reserve(screen_width, screen_height);
+    float flash_left = 0;
+    Image frame_image = GenImageColor(screen_width, screen_height, BLACK);
+    Texture2D frame_texture = LoadTextureFromImage(frame_image);
+    UnloadImage(frame_image);
+
+    const int agent_stages[agent_count] = {
+        profiler.add_stage("pathfinding_1"),
+        profiler.add_stage("pathfinding_2"),
+    };
+    // Counters follow the main thread only: a stage counts the jobs the main
+    // thread runs while it waits, not the bands the workers take.
+    // --threads 1 for whole-stage numbers.
+    if (perf_counters && !profiler.enable_counters())
+        std::cerr << "hardware counters are not available" << std::endl;
+    if (!profile_path.empty() && !profiler.open_csv(profile_path))
     {
-        float dt = GetFrameTime();
+        std::cerr << "can't write profile to " << profile_path << std::endl;
+        return 1;
+    }
 
-        Vector2 move_dir = { 0, 0 };
-        DisableCursor();
-        float delta = GetMouseDelta().x;
-        player.rotation += delta * 1e-3f * mouse_sensetivity;
-        Vector2 dir = Vector2Rotate({ 1, 0 }, player.rotation);
-        Vector2 forward = dir;
+    // F9 writes the last trace_frames frames, so does quitting
+    if (!trace_path.empty())
+    {
+        trace_thread_name("main");
+        trace_enabled = true;
+    }
+
+    // Movement, agents and collisions run on the simulation thread; the
+    // main thread only reads the snapshots it publishes.
+    SimulationRules rules;
+    rules.apply_input = [](WorldState &world, const InputFrame &input) {
+        turn(world.player, input);
+        if (input.down(INPUT_SHOOT))
+            shoot(world.player, world.objects);
+    };
+    std::vector<std::vector<CellPos>> agent_paths(agent_count);
+    rules.step = [&board, &agent_stages, &agent_paths](WorldState &world, const InputFrame &input,
+                                                       float dt, DebugDraw &debug) {
+        Vector2 forward = Vector2Rotate({ 1, 0 }, world.player.rotation);
         Vector2 right = Vector2Rotate(forward, PI / 2);
-        if (IsKeyDown(KEY_W))
+        Vector2 move_dir = { 0, 0 };
+        if (input.down(INPUT_FORWARD))
             move_dir += forward;
-        if (IsKeyDown(KEY_S))
+        if (input.down(INPUT_BACK))
             move_dir += -forward;
-        if (IsKeyDown(KEY_A))
+        if (input.down(INPUT_LEFT))
             move_dir += -right;
-        if (IsKeyDown(KEY_D))
+        if (input.down(INPUT_RIGHT))
             move_dir += right;
         move_dir = Vector2Normalize(move_dir);
-        
-        if (IsKeyPressed(KEY_T))
-            config.draw_map = !config.draw_map;
-
-        if (IsKeyPressed(KEY_SPACE))
-            shoot(player, objects);
-
-        std::vector<RayHit> hits;
-        for (float angle = -config.fov / 2; angle < config.fov / 2; angle += config.delta_angle) {
-            Vector2 d = {
-                cos(player.rotation + angle),
-                sin(player.rotation + angle),
-            };
-            RayHit hit = cast_ray(player.pos, d);
-            hits.push_back(hit);
+
+        // the agents chase where the player was before this step's move
+        auto move = [&](int agent, int) {
+            move_agent(*board, world, agent, agent_stages[agent - 1], agent_paths[agent - 1],
+                       dt, debug);
+        };
+        auto collide = [&](int, int) {
+            PROFILE_SCOPE(Stage::Collisions);
+            fix_collisions(*board, world.player, move_dir, dt, debug);
+        };
+        JobCounter agents, step;
+        for (int agent = 1; agent <= agent_count; agent++)
+            jobs.run(agents, move, agent, agent + 1);
+        jobs.run_after(agents, step, collide);
+        jobs.wait(step);
+    };
+    Simulation simulation(*board, view, 1 / sim_hz, std::move(rules), sim_thread);
+
+    using clock = std::chrono::steady_clock;
+    auto run_start = clock::now();
+    long frames = 0;
+    // how long an idle frame takes at least, one simulation step
+    const auto idle_frame_time = std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<float>(1 / sim_hz));
+
+    // A frame takes what it needs from the frame arena or from buffers
+    // kept across frames. Builds that count allocations report frames past
+    // the warm up that touch the heap anyway; a new part of the map or a
+    // longer path can still need more room, so that's a report, not a stop.
+    [[maybe_unused]] const long warmup_frames = 10;
+    [[maybe_unused]] long allocating_frames = 0;
+
+    while (!WindowShouldClose())
+    {
+        auto frame_start = clock::now();
+        ArenaScope frame_scope;
+        [[maybe_unused]] uint64_t frame_allocations = thread_allocation_count();
+
+        InputFrame input;
+        {
+            PROFILE_SCOPE(Stage::Input);
+            if (replay.is_open())
+            {
+                if (!replay.next(input))
+                    break;
+            }
+            else
+            {
+                input = poll_input();
+            }
+            if (recorder.is_open())
+                recorder.write(input);
+            frames++;
+
+            if (IsKeyPressed(KEY_P))
+                profiler.overlay = !profiler.overlay;
+            for (int i = 0; i < int(DebugCategory::Count); i++)
+            {
+                DebugCategory category = DebugCategory(i);
+                if (IsKeyPressed(KEY_F1 + i))
+                    debug_set_enabled(category, !debug_enabled(category));
+            }
+            // render features pick other kernels, no rebuild
+            for (int i = 0; (1 << i) < RENDER_FEATURE_COMBINATIONS; i++)
+            {
+                if (IsKeyPressed(KEY_F5 + i))
+                    settings.features ^= 1 << i;
+            }
+            if (IsKeyPressed(KEY_F9) && !trace_path.empty())
+            {
+                AllowAllocations allow;
+                trace_dump(trace_path, trace_frames);
+            }
+
+            DisableCursor();
+            if (input.down(INPUT_TOGGLE_MAP))
+                config.draw_map = !config.draw_map;
+            if (input.down(INPUT_SHOOT))
+                flash_left = muzzle_flash_time;
+            simulation.submit(input);
         }
 
-        BeginTextureMode(config.minimap);
-        draw_top_down_view(player, hits, objects);
-        EndTextureMode();
+        // Whatever frame the simulation finished last; the mouse turns the
+        // view right away, movement shows up when the simulation gets to it.
+        const WorldSnapshot &snapshot = simulation.latest();
+        float rotation = view.player.rotation;
+        interpolate_world(snapshot.previous, snapshot.current, snapshot.alpha, view);
+        view.player.rotation = rotation;
+        turn(view.player, input);
+        const Player &player = view.player;
 
-        if (objects.size() > 1)
+        // with the rays of the last frame; nothing at all while it's hidden
+        if (config.draw_map)
         {
-            std::vector<CellPos> path = find_path(objects[1].pos, player.pos);
-            if (path.size() > 1)
+            PROFILE_SCOPE(Stage::Minimap);
             {
-                CellPos c0 = path[1];
-                Vector2 p0 = {
-                    c0.x * 1.0f * cell_size + cell_size / 2.0f,
-                    c0.y * 1.0f * cell_size + cell_size / 2.0f,
-                };
-
-                Vector2 move = Vector2Normalize(p0 - objects[1].pos) * dt * 30;
-                objects[1].pos += move;
+                // blocking chunk lookups queue requests
+                AllowAllocations allow;
+                update_map_cells(*board, snapshot.board_revision);
             }
+            BeginTextureMode(config.minimap);
+            ClearBackground(BLANK);
+            draw_top_down_view(player, view.objects);
+            frame_debug.replay();
+            snapshot.debug.replay();
+            EndTextureMode();
         }
+        frame_debug.clear();
 
-        if (objects.size() > 2)
         {
-            std::vector<CellPos> path = find_path(objects[2].pos, player.pos);
-            if (path.size() > 1)
+            PROFILE_SCOPE(Stage::RayCasting);
+            {
+                // queues chunk requests as the player moves
+                AllowAllocations allow;
+                board->stream(player.pos);
+            }
+            // the columns of the last frame hold while the view stays put
+            if (frame_cache.view_changed(*board, snapshot.board_revision, player, config.fov,
+                                         frame, settings))
             {
-                CellPos c0 = path[1];
-                Vector2 p0 = {
-                    c0.x * 1.0f * cell_size + cell_size / 2.0f,
-                    c0.y * 1.0f * cell_size + cell_size / 2.0f,
-                };
-
-                Vector2 move = Vector2Normalize(p0 - objects[2].pos) * dt * 40;
-                objects[2].pos += move;
+                // so may the rays, reaching chunks that aren't loaded yet
+                AllowAllocations allow;
+                if (config.wall_segments)
+                    extract_view(*board, player, config.fov, frame.width, columns);
+                else
+                    cast_view(*board, player, config.fov, frame.width, columns, config.wall_span);
             }
         }
 
+        FrameUpdate update = FrameUpdate::None;
+        FrameVector<ViewQuad> view_quads;
+        if (gpu_view)
+        {
+            PROFILE_SCOPE(Stage::Walls);
+            view_quads = build_view_quads(frame.width, frame.height, player, columns,
+                                          view.objects, view_textures, settings);
+            update = FrameUpdate::Full;
+        }
+        else if (indexed)
+        {
+            colormap.update(indexed_assets.palette, settings);
+            render_view_indexed(indexed_frame, player, columns, view.objects, indexed_assets,
+                                colormap, settings);
+            PROFILE_SCOPE(Stage::Present);
+            expand_framebuffer(indexed_frame, indexed_assets.palette, frame);
+            update = FrameUpdate::Full;
+        }
+        else
+        {
+            update = frame_cache.render(frame, player, columns, view.objects, assets, settings);
+        }
+        if (config.draw_map)
+        {
+            draw_view_rays(player, columns, frame_debug);
+            draw_rays_to_objects(player, view.objects, frame_debug);
+        }
 
-        BeginDrawing();
         {
+            PROFILE_SCOPE(Stage::Present);
+            Color tint = muzzle_flash;
+            tint.a = (unsigned char) (muzzle_flash.a * flash_left / muzzle_flash_time);
+            bool tint_changed = tint.a != post.tint.a;
+            post.tint = tint;
+            flash_left = std::max(flash_left - input.dt, 0.0f);
+            if (upscale > 0)
+            {
+                post.scale_x = screen_width / frame.width;
+                post.scale_y = screen_height / frame.height;
+            }
+
+            // an unchanged frame only gets the HUD drawn over it again
+            if (!gpu_view && (update != FrameUpdate::None || tint_changed))
+            {
+                post_process(frame, post, post_frame);
+                UpdateTextureRec(frame_texture,
+                                 { 0, 0, float(post_frame.width), float(post_frame.height) },
+                                 post_frame.pixels.data());
+            }
+            BeginDrawing();
             ClearBackground(BLACK);
-            draw_raycast_view(player, hits, objects, config);
-            fix_collisions(player, move_dir, dt);
+            if (gpu_view)
+                draw_view_quads(view_quads, frame.width, frame.height,
+                                { 0, 0, float(screen_width), float(screen_height) });
+            else
+                DrawTexturePro(
+                    frame_texture,
+                    { 0, 0, float(post_frame.width), float(post_frame.height) },
+                    { 0, 0, float(screen_width), float(screen_height) },
+                    { 0, 0 }, 0, WHITE
+                );
+        }
+        {
+            PROFILE_SCOPE(Stage::Hud);
             draw_hands(hands);
             draw_crosshair();
+            if (config.draw_map)
+            {
+                DrawTexture(config.minimap.texture, 0, 0, WHITE);
+                draw_debug_legend(10, screen_height - 30 * int(DebugCategory::Count),
+                                  settings.features);
+            }
+            DrawFPS(10, 10);
+            if (target_ms > 0)
+                DrawText(TextFormat("res %d%%, floor 1/%d",
+                                    int(resolution.scale() * 100), settings.floor_step),
+                         110, 10, 20, LIME);
+            if (profiler.overlay)
+                draw_profiler_overlay(10, 40);
         }
-        if (config.draw_map)
-            DrawTexture(config.minimap.texture, 0, 0, WHITE);
-        DrawFPS(10, 10);
-        EndDrawing();
+        {
+            PROFILE_SCOPE(Stage::Present);
+            EndDrawing();
+        }
+
+        // Nothing redrawn and nothing pressed: sleep out the rest of a
+        // simulation step instead of spinning. Replays run flat out.
+        bool idle = update == FrameUpdate::None && post.tint.a == 0 && input.keys == 0 &&
+                    input.mouse_dx == 0 && !replay.is_open();
+        if (idle)
+            std::this_thread::sleep_until(frame_start + idle_frame_time);
+        profiler.end_frame();
+        trace_frame();
+        // the sleep isn't render time, idle frames don't steer the resolution
+        if (!idle && target_ms > 0 && resolution.update(profiler.last_frame_ms()))
+        {
+            frame.resize(resolution.columns(), view_height);
+            indexed_frame.resize(resolution.columns(), view_height);
+            settings.floor_step = resolution.floor_step();
+        }
+#if ALLOC_COUNTER_ENABLED
+        if (frames > warmup_frames && thread_allocation_count() != frame_allocations &&
+            allocating_frames++ == 0)
+        {
+            std::cerr << "frame " << frames << " allocated "
+                      << thread_allocation_count() - frame_allocations << " times" << std::endl;
+        }
+#endif
     }
+    UnloadTexture(frame_texture);
+    if (gpu_view)
+        unload_view_textures(view_textures);
+    UnloadRenderTexture(config.minimap_cells);
+    UnloadRenderTexture(config.minimap);
     CloseWindow();
 
+    if (!trace_path.empty() && !trace_dump(trace_path, trace_frames))
+        std::cerr << "can't write trace to " << trace_path << std::endl;
+#if ALLOC_COUNTER_ENABLED
+    if (allocating_frames > 0)
+        std::cerr << allocating_frames << " frames past the warm up allocated" << std::endl;
+#endif
+
+    if (replay.is_open())
+    {
+        double seconds = std::chrono::duration<double>(clock::now() - run_start).count();
+        std::cout << "replayed " << frames << " frames in " << seconds << " s, "
+                  << seconds * 1000 / std::max(frames, 1L) << " ms/frame" << std::endl;
+    }
+
     return 0;
 }
@@ -0,0 +1,188 @@
+#include "palette.hpp"
+#include "jobs.hpp"
+#include "simd.hpp"
+#include <algorithm>
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+uint8_t
+Palette::nearest(Color color) const
+{
+    int best = 1;
+    int best_dist = 1 << 30;
+    for (int i = 1; i < count; i++)
+    {
+        int dr = int(color.r) - colors[i].r;
+        int dg = int(color.g) - colors[i].g;
+        int db = int(color.b) - colors[i].b;
+        int dist = dr * dr + dg * dg + db * db;
+        if (dist < best_dist)
+        {
+            best = i;
+            best_dist = dist;
+        }
+    }
+    return uint8_t(best);
+}
+
+static bool
+is_opaque(Color color)
+{
+    return color.a >= 128;
+}
+
+namespace {
+
+// Colours [begin, end) of the sample list
+struct ColorBox {
+    size_t begin, end;
+    int channel; // widest one
+    int range;   // of that channel
+};
+
+uint8_t
+channel_of(Color color, int channel)
+{
+    return channel == 0 ? color.r : channel == 1 ? color.g : color.b;
+}
+
+ColorBox
+make_box(const std::vector<Color> &samples, size_t begin, size_t end)
+{
+    uint8_t lo[3] = { 255, 255, 255 };
+    uint8_t hi[3] = { 0, 0, 0 };
+    for (size_t i = begin; i < end; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            lo[c] = std::min(lo[c], channel_of(samples[i], c));
+            hi[c] = std::max(hi[c], channel_of(samples[i], c));
+        }
+    }
+    ColorBox box = { begin, end, 0, 0 };
+    for (int c = 0; c < 3; c++)
+    {
+        if (hi[c] - lo[c] > box.range)
+        {
+            box.channel = c;
+            box.range = hi[c] - lo[c];
+        }
+    }
+    return box;
+}
+
+}
+
+Palette
+build_palette(const std::vector<Image> &images)
+{
+    std::vector<Color> samples;
+    for (const Image &image : images)
+    {
+        Color *colors = LoadImageColors(image);
+        for (int i = 0; i < image.width * image.height; i++)
+        {
+            if (is_opaque(colors[i]))
+                samples.push_back(colors[i]);
+        }
+        UnloadImageColors(colors);
+    }
+
+    Palette palette;
+    if (samples.empty())
+        return palette;
+
+    // split the box with the widest channel at its median until the
+    // palette is full or no box holds more than one colour
+    std::vector<ColorBox> boxes = { make_box(samples, 0, samples.size()) };
+    while (boxes.size() < 255)
+    {
+        auto widest = std::max_element(boxes.begin(), boxes.end(),
+            [](const ColorBox &a, const ColorBox &b) { return a.range < b.range; });
+        if (widest->range == 0)
+            break;
+        ColorBox box = *widest;
+        size_t middle = box.begin + (box.end - box.begin) / 2;
+        std::nth_element(samples.begin() + box.begin, samples.begin() + middle,
+                         samples.begin() + box.end, [&](Color a, Color b) {
+                             return channel_of(a, box.channel) < channel_of(b, box.channel);
+                         });
+        *widest = make_box(samples, box.begin, middle);
+        boxes.push_back(make_box(samples, middle, box.end));
+    }
+
+    for (const ColorBox &box : boxes)
+    {
+        size_t sum[3] = { 0, 0, 0 };
+        for (size_t i = box.begin; i < box.end; i++)
+        {
+            for (int c = 0; c < 3; c++)
+                sum[c] += channel_of(samples[i], c);
+        }
+        size_t n = box.end - box.begin;
+        palette.colors[palette.count++] = Color {
+            uint8_t(sum[0] / n), uint8_t(sum[1] / n), uint8_t(sum[2] / n), 255
+        };
+    }
+    return palette;
+}
+
+IndexedImage
+quantize_image(const Palette &palette, const Image &image)
+{
+    IndexedImage result;
+    result.width = image.width;
+    result.height = image.height;
+    result.pixels.resize(size_t(image.width) * image.height);
+
+    Color *colors = LoadImageColors(image);
+    jobs.parallel_for(0, image.height, 16, [&](int y0, int y1) {
+        for (size_t i = size_t(y0) * image.width; i < size_t(y1) * image.width; i++)
+        {
+            result.pixels[i] = is_opaque(colors[i]) ? palette.nearest(colors[i])
+                                                    : palette_transparent;
+        }
+    });
+    UnloadImageColors(colors);
+    return result;
+}
+
+static void
+expand_scalar(const Color *colors, const uint8_t *src, Color *dst, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        dst[i] = colors[src[i]];
+}
+
+#if SIMD_X86
+SIMD_TARGET_AVX2 static void
+expand_avx2(const Color *colors, const uint8_t *src, Color *dst, size_t count)
+{
+    const int *table = reinterpret_cast<const int *>(colors);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i));
+        __m256i indices = _mm256_cvtepu8_epi32(bytes);
+        __m256i pixels = _mm256_i32gather_epi32(table, indices, 4);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), pixels);
+    }
+    expand_scalar(colors, src + i, dst + i, count - i);
+}
+#endif
+
+void
+expand_palette(const Palette &palette, const uint8_t *src, Color *dst, size_t count)
+{
+    static_assert(sizeof(Color) == 4, "palette entries are gathered as 32 bit words");
+#if SIMD_X86
+    if (simd_level() >= SimdLevel::AVX2)
+    {
+        expand_avx2(palette.colors, src, dst, count);
+        return;
+    }
+#endif
+    expand_scalar(palette.colors, src, dst, count);
+}
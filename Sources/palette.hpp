@@ -0,0 +1,40 @@
+#ifndef PALETTE_HPP
+#define PALETTE_HPP
+
+#include <raylib-ext.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Index of the see-through colour in every palette
+const uint8_t palette_transparent = 0;
+
+// Up to 256 colours shared by all indexed images
+struct Palette {
+    Color colors[256] = {}; // colors[palette_transparent] is BLANK
+    int count = 1;
+
+    // Closest opaque entry
+    uint8_t nearest(Color color) const;
+};
+
+// One palette index per pixel, rows top to bottom
+struct IndexedImage {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+// Median cut over the opaque pixels of all the images
+Palette
+build_palette(const std::vector<Image> &images);
+
+// Pixels under half alpha become palette_transparent
+IndexedImage
+quantize_image(const Palette &palette, const Image &image);
+
+// dst[i] = palette.colors[src[i]]; gathers 8 pixels at a time with AVX2
+void
+expand_palette(const Palette &palette, const uint8_t *src, Color *dst, size_t count);
+
+#endif // PALETTE_HPP
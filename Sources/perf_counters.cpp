@@ -0,0 +1,122 @@
+#include "perf_counters.hpp"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+static const char *counter_names[] = {
+    "cycles",
+    "instructions",
+    "l1d_misses",
+    "llc_misses",
+    "branch_misses",
+};
+
+static_assert(sizeof(counter_names) / sizeof(counter_names[0]) == size_t(Counter::Count),
+              "every counter needs a name");
+
+const char *
+counter_name(Counter counter)
+{
+    return counter_names[int(counter)];
+}
+
+#ifdef __linux__
+
+namespace {
+
+// One group per thread, read with a single syscall. Counters the CPU or the
+// hypervisor doesn't offer are left out and read as 0.
+struct CounterGroup {
+    int leader = -1;
+    int count = 0;
+    int slots[int(Counter::Count)];
+};
+
+thread_local CounterGroup group;
+
+int
+open_counter(uint32_t type, uint64_t config, int leader)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = leader == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return int(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+}
+
+}
+
+bool
+perf_counters_open()
+{
+    if (group.leader != -1)
+        return true;
+
+    const uint64_t l1d_read_miss = PERF_COUNT_HW_CACHE_L1D
+                                 | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                 | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    const struct {
+        uint32_t type;
+        uint64_t config;
+    } events[] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HW_CACHE, l1d_read_miss },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    };
+
+    group.leader = open_counter(events[0].type, events[0].config, -1);
+    if (group.leader == -1)
+        return false;
+    group.slots[0] = group.count++;
+    for (int i = 1; i < int(Counter::Count); i++)
+    {
+        int fd = open_counter(events[i].type, events[i].config, group.leader);
+        group.slots[i] = fd == -1 ? -1 : group.count++;
+    }
+
+    ioctl(group.leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(group.leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+}
+
+bool
+perf_counters_read(CounterValues &out)
+{
+    if (group.leader == -1)
+        return false;
+
+    uint64_t buffer[1 + int(Counter::Count)];
+    if (read(group.leader, buffer, sizeof(buffer)) < ssize_t(sizeof(uint64_t)))
+        return false;
+    for (int i = 0; i < int(Counter::Count); i++)
+        out.values[i] = group.slots[i] == -1 ? 0 : buffer[1 + group.slots[i]];
+    return true;
+}
+
+#else
+
+bool
+perf_counters_open()
+{
+    return false;
+}
+
+bool
+perf_counters_read(CounterValues &)
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+#include <cstdint>
+
+// Hardware counters through perf_event_open. Linux only; everywhere else,
+// and where perf_event_paranoid forbids it, opening just fails.
+
+enum class Counter {
+    Cycles,
+    Instructions,
+    L1dMisses,
+    LlcMisses,
+    BranchMisses,
+    Count,
+};
+
+struct CounterValues {
+    uint64_t values[int(Counter::Count)] = {};
+
+    uint64_t operator[](Counter c) const { return values[int(c)]; }
+};
+
+const char *
+counter_name(Counter counter);
+
+// Counts the calling thread only; other threads read nothing
+bool
+perf_counters_open();
+
+bool
+perf_counters_read(CounterValues &out);
+
+#endif // PERF_COUNTERS_HPP
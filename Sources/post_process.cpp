@@ -0,0 +1,367 @@
+#include "post_process.hpp"
+#include "frame_arena.hpp"
+#include "jobs.hpp"
+#include "simd.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+void
+GammaLut::build(float gamma, float brightness)
+{
+    this->gamma = gamma;
+    this->brightness = brightness;
+    for (int i = 0; i < 256; i++)
+    {
+        float value = 255 * (std::pow(i / 255.0f, 1 / gamma) + brightness);
+        table[i] = uint8_t(std::clamp(std::lround(value), 0L, 255L));
+    }
+}
+
+// out = (in * (256 - w) + tint * w) / 256 per channel, with w the tint alpha
+// stretched to 0..256 and 0 for the alpha channel, so it stays as it was
+struct TintWeights {
+    uint16_t keep[4];
+    uint16_t add[4];
+};
+
+static TintWeights
+tint_weights(Color tint)
+{
+    uint16_t w = tint.a + (tint.a >> 7);
+    return TintWeights {
+        { uint16_t(256 - w), uint16_t(256 - w), uint16_t(256 - w), 256 },
+        { uint16_t(tint.r * w), uint16_t(tint.g * w), uint16_t(tint.b * w), 0 },
+    };
+}
+
+static void
+tint_scalar(Color *pixels, size_t count, const TintWeights &weights)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        unsigned char *channels = &pixels[i].r;
+        for (int c = 0; c < 4; c++)
+            channels[c] = uint8_t((channels[c] * weights.keep[c] + weights.add[c]) >> 8);
+    }
+}
+
+#if SIMD_X86
+// Four 16 bit weights, for two pixels
+SIMD_TARGET_SSE2 static __m128i
+load_weights(const uint16_t *weights)
+{
+    __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(weights));
+    return _mm_unpacklo_epi64(v, v);
+}
+
+SIMD_TARGET_SSE2 static void
+tint_sse2(Color *pixels, size_t count, const TintWeights &weights)
+{
+    __m128i keep = load_weights(weights.keep);
+    __m128i add = load_weights(weights.add);
+    __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i *p = reinterpret_cast<__m128i *>(pixels + i);
+        __m128i v = _mm_loadu_si128(p);
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+        lo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(lo, keep), add), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(hi, keep), add), 8);
+        _mm_storeu_si128(p, _mm_packus_epi16(lo, hi));
+    }
+    tint_scalar(pixels + i, count - i, weights);
+}
+
+SIMD_TARGET_AVX2 static void
+tint_avx2(Color *pixels, size_t count, const TintWeights &weights)
+{
+    __m256i keep = _mm256_broadcastsi128_si256(load_weights(weights.keep));
+    __m256i add = _mm256_broadcastsi128_si256(load_weights(weights.add));
+    __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i *p = reinterpret_cast<__m256i *>(pixels + i);
+        __m256i v = _mm256_loadu_si256(p);
+        // unpacking and packing both work within 128 bit lanes, the pixel
+        // order comes out as it went in
+        __m256i lo = _mm256_unpacklo_epi8(v, zero);
+        __m256i hi = _mm256_unpackhi_epi8(v, zero);
+        lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(lo, keep), add), 8);
+        hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(hi, keep), add), 8);
+        _mm256_storeu_si256(p, _mm256_packus_epi16(lo, hi));
+    }
+    tint_scalar(pixels + i, count - i, weights);
+}
+#endif
+
+void
+tint_pixels(Color *pixels, size_t count, Color tint)
+{
+    if (tint.a == 0)
+        return;
+    TintWeights weights = tint_weights(tint);
+#if SIMD_X86
+    SimdLevel level = simd_level();
+    if (level >= SimdLevel::AVX2)
+    {
+        tint_avx2(pixels, count, weights);
+        return;
+    }
+    if (level >= SimdLevel::SSE2)
+    {
+        tint_sse2(pixels, count, weights);
+        return;
+    }
+#endif
+    tint_scalar(pixels, count, weights);
+}
+
+// Stays scalar: a 256 entry byte table takes 16 shuffles per vector with
+// AVX2, which came out slower than plain loads
+static void
+lut_scalar(Color *pixels, size_t count, const uint8_t *table)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        pixels[i].r = table[pixels[i].r];
+        pixels[i].g = table[pixels[i].g];
+        pixels[i].b = table[pixels[i].b];
+    }
+}
+
+void
+apply_lut(Color *pixels, size_t count, const GammaLut &lut)
+{
+    if (lut.identity())
+        return;
+    lut_scalar(pixels, count, lut.table);
+}
+
+static void
+upscale_scalar(const Color *src, int width, int scale, Color *dst)
+{
+    for (int x = 0; x < width; x++)
+    {
+        for (int k = 0; k < scale; k++)
+            *dst++ = src[x];
+    }
+}
+
+#if SIMD_X86
+// Eight output pixels come from at most eight neighbouring source pixels;
+// which of them depends only on where the eight start within a run of
+// `scale`, so there are at most `scale` permutations
+SIMD_TARGET_AVX2 static void
+upscale_avx2(const Color *src, int width, int scale, Color *dst)
+{
+    const int max_scale = 16;
+    if (scale > max_scale)
+    {
+        upscale_scalar(src, width, scale, dst);
+        return;
+    }
+
+    __m256i permutes[max_scale];
+    for (int phase = 0; phase < scale; phase++)
+    {
+        int index[8];
+        for (int k = 0; k < 8; k++)
+            index[k] = (phase + k) / scale;
+        permutes[phase] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(index));
+    }
+
+    int out_width = width * scale;
+    int x = 0;
+    for (; x + 8 <= out_width; x += 8)
+    {
+        int first = x / scale;
+        if (first + 8 > width)
+            break;
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + first));
+        __m256i out = _mm256_permutevar8x32_epi32(v, permutes[x % scale]);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), out);
+    }
+    for (; x < out_width; x++)
+        dst[x] = src[x / scale];
+}
+#endif
+
+void
+upscale_row(const Color *src, int width, int scale, Color *dst)
+{
+    if (scale == 1)
+    {
+        std::memcpy(dst, src, size_t(width) * sizeof(Color));
+        return;
+    }
+#if SIMD_X86
+    if (simd_level() >= SimdLevel::AVX2)
+    {
+        upscale_avx2(src, width, scale, dst);
+        return;
+    }
+#endif
+    upscale_scalar(src, width, scale, dst);
+}
+
+static void
+transpose_scalar(const Color *src, size_t src_stride, int rows, int cols,
+                 Color *dst, size_t dst_stride)
+{
+    for (int r = 0; r < rows; r++)
+    {
+        for (int c = 0; c < cols; c++)
+            dst[c * dst_stride + r] = src[r * src_stride + c];
+    }
+}
+
+#if SIMD_X86
+SIMD_TARGET_SSE2 static void
+transpose_sse2(const Color *src, size_t src_stride, int rows, int cols,
+               Color *dst, size_t dst_stride)
+{
+    int r = 0;
+    for (; r + 4 <= rows; r += 4)
+    {
+        int c = 0;
+        for (; c + 4 <= cols; c += 4)
+        {
+            __m128i v[4];
+            for (int k = 0; k < 4; k++)
+                v[k] = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i *>(src + (r + k) * src_stride + c));
+            __m128i t0 = _mm_unpacklo_epi32(v[0], v[1]);
+            __m128i t1 = _mm_unpacklo_epi32(v[2], v[3]);
+            __m128i t2 = _mm_unpackhi_epi32(v[0], v[1]);
+            __m128i t3 = _mm_unpackhi_epi32(v[2], v[3]);
+            __m128i out[4] = {
+                _mm_unpacklo_epi64(t0, t1),
+                _mm_unpackhi_epi64(t0, t1),
+                _mm_unpacklo_epi64(t2, t3),
+                _mm_unpackhi_epi64(t2, t3),
+            };
+            for (int k = 0; k < 4; k++)
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + (c + k) * dst_stride + r),
+                                 out[k]);
+        }
+        transpose_scalar(src + r * src_stride + c, src_stride, 4, cols - c,
+                         dst + c * dst_stride + r, dst_stride);
+    }
+    transpose_scalar(src + r * src_stride, src_stride, rows - r, cols, dst + r, dst_stride);
+}
+
+SIMD_TARGET_AVX2 static void
+transpose_avx2(const Color *src, size_t src_stride, int rows, int cols,
+               Color *dst, size_t dst_stride)
+{
+    int r = 0;
+    for (; r + 8 <= rows; r += 8)
+    {
+        int c = 0;
+        for (; c + 8 <= cols; c += 8)
+        {
+            __m256i v[8];
+            for (int k = 0; k < 8; k++)
+                v[k] = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i *>(src + (r + k) * src_stride + c));
+            // 2 x 2 blocks of pixels, then of pairs, within each 128 bit
+            // lane; the lanes swap last
+            __m256i t[8], u[8];
+            for (int k = 0; k < 8; k += 2)
+            {
+                t[k] = _mm256_unpacklo_epi32(v[k], v[k + 1]);
+                t[k + 1] = _mm256_unpackhi_epi32(v[k], v[k + 1]);
+            }
+            for (int k = 0; k < 8; k += 4)
+            {
+                u[k] = _mm256_unpacklo_epi64(t[k], t[k + 2]);
+                u[k + 1] = _mm256_unpackhi_epi64(t[k], t[k + 2]);
+                u[k + 2] = _mm256_unpacklo_epi64(t[k + 1], t[k + 3]);
+                u[k + 3] = _mm256_unpackhi_epi64(t[k + 1], t[k + 3]);
+            }
+            for (int k = 0; k < 4; k++)
+            {
+                __m256i low = _mm256_permute2x128_si256(u[k], u[k + 4], 0x20);
+                __m256i high = _mm256_permute2x128_si256(u[k], u[k + 4], 0x31);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + (c + k) * dst_stride + r),
+                                    low);
+                _mm256_storeu_si256(
+                    reinterpret_cast<__m256i *>(dst + (c + k + 4) * dst_stride + r), high);
+            }
+        }
+        transpose_scalar(src + r * src_stride + c, src_stride, 8, cols - c,
+                         dst + c * dst_stride + r, dst_stride);
+    }
+    transpose_scalar(src + r * src_stride, src_stride, rows - r, cols, dst + r, dst_stride);
+}
+#endif
+
+void
+transpose_pixels(const Color *src, size_t src_stride, int rows, int cols,
+                 Color *dst, size_t dst_stride)
+{
+#if SIMD_X86
+    SimdLevel level = simd_level();
+    if (level >= SimdLevel::AVX2)
+    {
+        transpose_avx2(src, src_stride, rows, cols, dst, dst_stride);
+        return;
+    }
+    if (level >= SimdLevel::SSE2)
+    {
+        transpose_sse2(src, src_stride, rows, cols, dst, dst_stride);
+        return;
+    }
+#endif
+    transpose_scalar(src, src_stride, rows, cols, dst, dst_stride);
+}
+
+void
+post_process(const Framebuffer &src, const PostSettings &settings, Framebuffer &dst)
+{
+    int scale_x = std::max(settings.scale_x, 1);
+    int scale_y = std::max(settings.scale_y, 1);
+    int out_width = src.width * scale_x;
+    if (dst.width != out_width || dst.height != src.height * scale_y ||
+        dst.order != PixelOrder::Rows)
+    {
+        dst.order = PixelOrder::Rows;
+        dst.resize(out_width, src.height * scale_y);
+    }
+
+    // source rows per job
+    const int row_grain = 16;
+    bool columns = src.order == PixelOrder::Columns;
+    jobs.parallel_for(0, src.height, row_grain, [&](int y0, int y1) {
+        ArenaScope scope;
+        FrameVector<Color> scratch(scale_x > 1 ? src.width : 0);
+        // the band's rows, gathered from the columns a tile at a time
+        FrameVector<Color> band(columns ? size_t(y1 - y0) * src.width : 0);
+        if (columns)
+            transpose_pixels(src.pixels.data() + y0, src.height, src.width, y1 - y0,
+                             band.data(), src.width);
+        for (int y = y0; y < y1; y++)
+        {
+            const Color *in = columns ? band.data() + size_t(y - y0) * src.width
+                                      : src.pixels.data() + size_t(y) * src.width;
+            Color *out = dst.row(y * scale_y);
+            // the colour passes run before upscaling, on fewer pixels
+            Color *row = scale_x > 1 ? scratch.data() : out;
+            std::memcpy(row, in, size_t(src.width) * sizeof(Color));
+            tint_pixels(row, src.width, settings.tint);
+            apply_lut(row, src.width, settings.lut);
+            if (scale_x > 1)
+                upscale_row(row, src.width, scale_x, out);
+            for (int k = 1; k < scale_y; k++)
+                std::memcpy(dst.row(y * scale_y + k), out, size_t(out_width) * sizeof(Color));
+        }
+    });
+}
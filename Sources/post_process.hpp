@@ -0,0 +1,52 @@
+#ifndef POST_PROCESS_HPP
+#define POST_PROCESS_HPP
+
+#include "render.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// Per channel table for gamma and brightness; alpha is left alone
+struct GammaLut {
+    uint8_t table[256];
+    float gamma = 1;
+    float brightness = 0;
+
+    GammaLut() { build(1, 0); }
+    // out = 255 * (in / 255)^(1 / gamma) + 255 * brightness
+    void build(float gamma, float brightness);
+    bool identity() const { return gamma == 1 && brightness == 0; }
+};
+
+struct PostSettings {
+    Color tint = BLANK; // flash colour, alpha is how much of it
+    GammaLut lut;
+    int scale_x = 1;    // nearest neighbour, whole pixels
+    int scale_y = 1;
+};
+
+// The passes one at a time, over count pixels. Tinting and upscaling use
+// SSE2 or AVX2 when the CPU has them; every level gives the same bytes.
+void
+tint_pixels(Color *pixels, size_t count, Color tint);
+
+void
+apply_lut(Color *pixels, size_t count, const GammaLut &lut);
+
+// Each of the width pixels of src scale times into dst
+void
+upscale_row(const Color *src, int width, int scale, Color *dst);
+
+// dst[c * dst_stride + r] = src[r * src_stride + c] for the rows x cols
+// block at src; in 8 x 8 tiles with AVX2, 4 x 4 with SSE2
+void
+transpose_pixels(const Color *src, size_t src_stride, int rows, int cols,
+                 Color *dst, size_t dst_stride);
+
+// src tinted, through the table and upscaled into dst, which is resized to
+// fit and always in row order. One pass over src in row bands on the job
+// system; a band of a column order frame is transposed first. The frame
+// itself is left as it was, so a cached frame can be processed again.
+void
+post_process(const Framebuffer &src, const PostSettings &settings, Framebuffer &dst);
+
+#endif // POST_PROCESS_HPP
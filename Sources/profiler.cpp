@@ -0,0 +1,255 @@
+#include "profiler.hpp"
+#include <raylib-ext.hpp>
+#include <algorithm>
+#include <cstdio>
+
+Profiler profiler;
+
+static const char *stage_names[] = {
+    "input",
+    "ray_casting",
+    "minimap",
+    "pathfinding",
+    "floor_ceiling",
+    "walls",
+    "sprites",
+    "collisions",
+    "hud",
+    "present",
+};
+
+static_assert(sizeof(stage_names) / sizeof(stage_names[0]) == size_t(Stage::Count),
+              "every stage needs a name");
+
+Profiler::Profiler()
+    : names(stage_names, stage_names + int(Stage::Count)),
+      current(names.size()),
+      history(names.size(), std::vector<float>(window, 0.0f)),
+      frame_history(window, 0.0f),
+      frame_start(clock::now())
+{
+}
+
+int
+Profiler::add_stage(const std::string &name)
+{
+    if (frozen)
+        return -1;
+    names.push_back(name);
+    current = std::vector<std::atomic<int64_t>>(names.size());
+    history.emplace_back(window, 0.0f);
+    if (counters)
+    {
+        current_counters = std::vector<AtomicCounters>(names.size());
+        counter_history.emplace_back(window);
+    }
+    return int(names.size()) - 1;
+}
+
+bool
+Profiler::enable_counters()
+{
+    if (frozen || !perf_counters_open())
+        return false;
+    counters = true;
+    current_counters = std::vector<AtomicCounters>(names.size());
+    counter_history.assign(names.size(), std::vector<CounterValues>(window));
+    return true;
+}
+
+void
+Profiler::add_counters(int stage, const CounterValues &begin, const CounterValues &end)
+{
+    if (stage < 0)
+        return;
+    for (int i = 0; i < int(Counter::Count); i++)
+        current_counters[stage][i].fetch_add(end.values[i] - begin.values[i],
+                                             std::memory_order_relaxed);
+}
+
+CounterValues
+Profiler::counter_average(int stage) const
+{
+    CounterValues average;
+    int count = std::min(frames, window);
+    if (!counters || count == 0)
+        return average;
+    for (int f = 0; f < count; f++)
+        for (int i = 0; i < int(Counter::Count); i++)
+            average.values[i] += counter_history[stage][f].values[i];
+    for (auto &value : average.values)
+        value /= count;
+    return average;
+}
+
+void
+Profiler::add_time(int stage, clock::duration elapsed)
+{
+    if (stage < 0)
+        return;
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    current[stage].fetch_add(ns, std::memory_order_relaxed);
+}
+
+void
+Profiler::end_frame()
+{
+    frozen = true;
+    clock::time_point now = clock::now();
+    float frame_ms = std::chrono::duration<float, std::milli>(now - frame_start).count();
+    frame_start = now;
+
+    int slot = frames % window;
+    frame_history[slot] = frame_ms;
+    for (size_t i = 0; i < names.size(); i++)
+        history[i][slot] = current[i].exchange(0, std::memory_order_relaxed) * 1e-6f;
+    if (counters)
+        for (size_t i = 0; i < names.size(); i++)
+            for (int c = 0; c < int(Counter::Count); c++)
+                counter_history[i][slot].values[c] =
+                    current_counters[i][c].exchange(0, std::memory_order_relaxed);
+
+    if (csv.is_open())
+    {
+        if (frames == 0)
+            write_csv_header();
+        csv << frames << ',' << frame_ms;
+        for (size_t i = 0; i < names.size(); i++)
+            csv << ',' << history[i][slot];
+        if (counters)
+            for (size_t i = 0; i < names.size(); i++)
+                for (uint64_t value : counter_history[i][slot].values)
+                    csv << ',' << value;
+        csv << '\n';
+    }
+    frames++;
+}
+
+bool
+Profiler::open_csv(const std::string &path)
+{
+    csv.open(path, std::ios::trunc);
+    return csv.is_open();
+}
+
+void
+Profiler::write_csv_header()
+{
+    csv << "frame,frame_ms";
+    for (auto &name : names)
+        csv << ',' << name << "_ms";
+    if (counters)
+        for (auto &name : names)
+            for (int c = 0; c < int(Counter::Count); c++)
+                csv << ',' << name << '_' << counter_name(Counter(c));
+    csv << '\n';
+}
+
+StageStats
+Profiler::window_stats(const std::vector<float> &samples) const
+{
+    int count = std::min(frames, window);
+    if (count == 0)
+        return StageStats { 0, 0, 0 };
+
+    float sorted[window];
+    std::copy(samples.begin(), samples.begin() + count, sorted);
+    std::sort(sorted, sorted + count);
+    float sum = 0;
+    for (int i = 0; i < count; i++)
+        sum += sorted[i];
+    return StageStats {
+        sorted[0],
+        sum / count,
+        sorted[std::min(count - 1, count * 99 / 100)],
+    };
+}
+
+StageStats
+Profiler::stats(int stage) const
+{
+    return window_stats(history[stage]);
+}
+
+StageStats
+Profiler::frame_stats() const
+{
+    return window_stats(frame_history);
+}
+
+float
+Profiler::last_frame_ms() const
+{
+    return frames > 0 ? frame_history[(frames - 1) % window] : 0.0f;
+}
+
+static void
+draw_stats_row(int x, int y, const char *name, StageStats s, Color color)
+{
+    const int font = 10;
+    char text[32];
+    DrawText(name, x, y, font, color);
+    const float values[] = { s.min_ms, s.avg_ms, s.p99_ms };
+    for (int i = 0; i < 3; i++)
+    {
+        std::snprintf(text, sizeof(text), "%.2f", values[i]);
+        DrawText(text, x + 140 + i * 50, y, font, color);
+    }
+}
+
+// ipc and thousands of misses per frame
+static void
+draw_counters_row(int x, int y, const CounterValues &c, Color color)
+{
+    const int font = 10;
+    char text[32];
+    uint64_t cycles = c[Counter::Cycles];
+    std::snprintf(text, sizeof(text), "%.2f",
+                  cycles ? double(c[Counter::Instructions]) / cycles : 0.0);
+    DrawText(text, x, y, font, color);
+    const Counter misses[] = { Counter::L1dMisses, Counter::LlcMisses, Counter::BranchMisses };
+    for (int i = 0; i < 3; i++)
+    {
+        std::snprintf(text, sizeof(text), "%.1f", c[misses[i]] * 1e-3);
+        DrawText(text, x + 40 + i * 50, y, font, color);
+    }
+}
+
+void
+draw_profiler_overlay(int x, int y)
+{
+    const int font = 10;
+    const int line = 12;
+    const int counters_x = x + 300;
+    bool counters = profiler.counters_enabled();
+    int rows = profiler.stage_count() + 2;
+    DrawRectangle(x - 4, y - 4, counters ? 490 : 300, rows * line + 8, Color { 0, 0, 0, 180 });
+
+    DrawText("stage, ms", x, y, font, GRAY);
+    const char *columns[] = { "min", "avg", "p99" };
+    for (int i = 0; i < 3; i++)
+        DrawText(columns[i], x + 140 + i * 50, y, font, GRAY);
+    if (counters)
+    {
+        const char *counter_columns[] = { "ipc", "l1d k", "llc k", "br k" };
+        DrawText(counter_columns[0], counters_x, y, font, GRAY);
+        for (int i = 0; i < 3; i++)
+            DrawText(counter_columns[i + 1], counters_x + 40 + i * 50, y, font, GRAY);
+    }
+    y += line;
+
+    StageStats frame = profiler.frame_stats();
+    draw_stats_row(x, y, "frame", frame, YELLOW);
+    y += line;
+
+    // stages taking over half the frame stand out
+    for (int i = 0; i < profiler.stage_count(); i++)
+    {
+        StageStats s = profiler.stats(i);
+        Color color = s.p99_ms > frame.avg_ms * 0.5f ? ORANGE : WHITE;
+        draw_stats_row(x, y, profiler.stage_name(i).c_str(), s, color);
+        if (counters)
+            draw_counters_row(counters_x, y, profiler.counter_average(i), color);
+        y += line;
+    }
+}
@@ -0,0 +1,131 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "perf_counters.hpp"
+#include "trace.hpp"
+
+enum class Stage {
+    Input,
+    RayCasting,
+    Minimap,
+    Pathfinding,
+    FloorCeiling,
+    Walls,
+    Sprites,
+    Collisions,
+    Hud,
+    Present,
+    Count,
+};
+
+struct StageStats {
+    float min_ms;
+    float avg_ms;
+    float p99_ms;
+};
+
+// Accumulates the time spent in each stage of a frame and keeps a rolling
+// window of per-frame totals. Scopes may close on any thread.
+class Profiler
+{
+public:
+    using clock = std::chrono::steady_clock;
+    static constexpr int window = 240;
+
+    Profiler();
+
+    // Extra stages (one per agent and so on) have to be added before the
+    // first end_frame() so the CSV header can list them.
+    int add_stage(const std::string &name);
+    int stage_count() const { return int(names.size()); }
+    const std::string &stage_name(int stage) const { return names[stage]; }
+
+    void add_time(int stage, clock::duration elapsed);
+
+    // Hardware counters for scopes on the calling thread, same rule as
+    // add_stage(); false if the platform won't give us any. Jobs that other
+    // threads run for a stage aren't in its counts.
+    bool enable_counters();
+    bool counters_enabled() const { return counters; }
+    void add_counters(int stage, const CounterValues &begin, const CounterValues &end);
+    CounterValues counter_average(int stage) const; // per frame
+    void end_frame();
+
+    bool open_csv(const std::string &path);
+
+    StageStats stats(int stage) const;
+    StageStats frame_stats() const;
+    float last_frame_ms() const;
+
+    bool overlay = false;
+
+private:
+    StageStats window_stats(const std::vector<float> &history) const;
+    void write_csv_header();
+
+    std::deque<std::string> names; // stable, the tracer keeps c_str()
+    std::vector<std::atomic<int64_t>> current; // ns, this frame
+    std::vector<std::vector<float>> history;   // ms, ring buffer per stage
+    std::vector<float> frame_history;
+    using AtomicCounters = std::array<std::atomic<uint64_t>, size_t(Counter::Count)>;
+    std::vector<AtomicCounters> current_counters;
+    std::vector<std::vector<CounterValues>> counter_history;
+    bool counters = false;
+    int frames = 0;
+    clock::time_point frame_start;
+    bool frozen = false;
+    std::ofstream csv;
+};
+
+extern Profiler profiler;
+
+class ProfileScope
+{
+public:
+    explicit ProfileScope(int stage) : stage(stage)
+    {
+        counting = profiler.counters_enabled() && perf_counters_read(counters_start);
+        start = Profiler::clock::now();
+    }
+    explicit ProfileScope(Stage stage) : ProfileScope(int(stage)) {}
+
+    ~ProfileScope()
+    {
+        auto end = Profiler::clock::now();
+        profiler.add_time(stage, end - start);
+        CounterValues counters_end;
+        if (counting && perf_counters_read(counters_end))
+            profiler.add_counters(stage, counters_start, counters_end);
+        if (stage >= 0 && trace_enabled.load(std::memory_order_relaxed))
+            trace_event(profiler.stage_name(stage).c_str(), to_trace(start), to_trace(end));
+    }
+
+private:
+    static uint64_t to_trace(Profiler::clock::time_point t)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            t.time_since_epoch()).count();
+    }
+
+    int stage;
+    Profiler::clock::time_point start;
+    bool counting;
+    CounterValues counters_start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(stage) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(stage)
+
+void
+draw_profiler_overlay(int x, int y);
+
+#endif // PROFILER_HPP
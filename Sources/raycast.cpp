@@ -0,0 +1,309 @@
+#include "raycast.hpp"
+#include <algorithm>
+#include <climits>
+#include <unordered_map>
+#include <unordered_set>
+
+RayHit
+cast_ray(const Board &board, Vector2 pos, Vector2 dir)
+{
+    RayHit hit;
+    hit.is_horizontal = false;
+
+    Vector2 start = pos / cell_size;
+    CellPos cell(get_cell(pos));
+    float t = 0;
+
+    // The starting cell never stops the ray. Every step leaves the current
+    // uniform node through its nearest side, so empty quadtree nodes are
+    // crossed at once and the dense board degrades to a plain grid DDA.
+    BoardNode node = { 0, cell, CellPos(cell.x + 1, cell.y + 1) };
+    for (;;)
+    {
+        float tx = INFINITY;
+        float ty = INFINITY;
+        if (dir.x > 0) tx = (node.max.x - start.x) / dir.x;
+        if (dir.x < 0) tx = (node.min.x - start.x) / dir.x;
+        if (dir.y > 0) ty = (node.max.y - start.y) / dir.y;
+        if (dir.y < 0) ty = (node.min.y - start.y) / dir.y;
+
+        if (tx < ty)
+        {
+            t = tx;
+            cell.x = dir.x > 0 ? node.max.x : node.min.x - 1;
+            cell.y = std::clamp(int(std::floor(start.y + dir.y * t)),
+                                node.min.y, node.max.y - 1);
+            hit.is_horizontal = false;
+        }
+        else
+        {
+            t = ty;
+            cell.y = dir.y > 0 ? node.max.y : node.min.y - 1;
+            cell.x = std::clamp(int(std::floor(start.x + dir.x * t)),
+                                node.min.x, node.max.x - 1);
+            hit.is_horizontal = true;
+        }
+
+        if (!board.contains(cell)) break;
+        node = board.node(cell.x, cell.y);
+        if (node.value != 0) break;
+    }
+
+    hit.cell_pos = cell;
+    hit.pos = pos + dir * (t * cell_size);
+    return hit;
+}
+
+void
+ColumnBuffer::reserve(int n)
+{
+    ray_x.reserve(n);
+    ray_y.reserve(n);
+    perp_dist.reserve(n);
+    tex_u.reserve(n);
+    tex_id.reserve(n);
+    face.reserve(n);
+    cell.reserve(n);
+    plane.reserve(n);
+}
+
+void
+ColumnBuffer::resize(int n)
+{
+    count = n;
+    ray_x.resize(n);
+    ray_y.resize(n);
+    perp_dist.resize(n);
+    tex_u.resize(n);
+    tex_id.resize(n);
+    face.resize(n);
+    cell.resize(n);
+}
+
+void
+ColumnBuffer::build_plane(float fov)
+{
+    this->fov = fov;
+    plane_half = std::tan(fov / 2);
+    plane.resize(count);
+    for (int x = 0; x < count; x++)
+        plane[x] = plane_half * (2 * (x + 0.5f) / count - 1);
+}
+
+void
+ColumnBuffer::store(int x, Vector2 ray, Vector2 hit_pos, CellPos cell, uint8_t face,
+                    uint8_t id)
+{
+    Vector2 pos_in_cell = hit_pos / cell_size - Vector2 { float(cell.x), float(cell.y) };
+    bool horizontal = face == FACE_NORTH || face == FACE_SOUTH;
+    ray_x[x] = ray.x;
+    ray_y[x] = ray.y;
+    perp_dist[x] = Vector2DotProduct(hit_pos - origin, forward);
+    tex_u[x] = std::clamp(horizontal ? pos_in_cell.x : pos_in_cell.y, 0.0f, 0.9999f);
+    tex_id[x] = id;
+    this->face[x] = face;
+    this->cell[x] = cell;
+}
+
+static void
+cast_column(const Board &board, ColumnBuffer &columns, int x)
+{
+    Vector2 ray = columns.forward + columns.right * columns.plane[x];
+    RayHit hit = cast_ray(board, columns.origin, ray);
+    uint8_t face;
+    if (hit.is_horizontal)
+        face = ray.y > 0 ? FACE_NORTH : FACE_SOUTH;
+    else
+        face = ray.x > 0 ? FACE_WEST : FACE_EAST;
+    uint8_t tex_id = board.contains(hit.cell_pos) ? board.at(hit.cell_pos) : 0;
+    columns.store(x, ray, hit.pos, hit.cell_pos, face, tex_id);
+    columns.rays_cast++;
+}
+
+// Columns a and b are cast. When both see the same face of the same cell
+// the columns between see it too, barring a thin occluder, and their hits
+// are where their rays cross the face's line: exact, so distance and u are
+// perspective correct. Otherwise the span is halved.
+static void
+fill_span(const Board &board, ColumnBuffer &columns, int a, int b, int max_span)
+{
+    if (b - a <= 1)
+        return;
+
+    if (b - a <= max_span && columns.cell[a] == columns.cell[b] &&
+        columns.face[a] == columns.face[b])
+    {
+        CellPos cell = columns.cell[a];
+        uint8_t face = columns.face[a];
+        bool horizontal = face == FACE_NORTH || face == FACE_SOUTH;
+        float line = float(cell_size) * (horizontal ? cell.y + (face == FACE_SOUTH)
+                                                    : cell.x + (face == FACE_EAST));
+        for (int x = a + 1; x < b; x++)
+        {
+            Vector2 ray = columns.forward + columns.right * columns.plane[x];
+            float t = horizontal ? (line - columns.origin.y) / ray.y
+                                 : (line - columns.origin.x) / ray.x;
+            columns.store(x, ray, columns.origin + ray * t, cell, face, columns.tex_id[a]);
+        }
+        return;
+    }
+
+    int m = (a + b) / 2;
+    cast_column(board, columns, m);
+    fill_span(board, columns, a, m, max_span);
+    fill_span(board, columns, m, b, max_span);
+}
+
+void
+ColumnBuffer::set_camera(const Player &player, float fov, int n)
+{
+    if (count != n || this->fov != fov)
+    {
+        resize(n);
+        build_plane(fov);
+    }
+
+    float c = std::cos(player.rotation);
+    float s = std::sin(player.rotation);
+    origin = player.pos;
+    forward = { c, s };
+    right = { -s, c };
+    rays_cast = 0;
+}
+
+void
+cast_view(const Board &board, const Player &player, float fov, int rays_count,
+          ColumnBuffer &columns, int max_span)
+{
+    columns.set_camera(player, fov, rays_count);
+    if (rays_count <= 0)
+        return;
+
+    if (max_span <= 1)
+    {
+        for (int x = 0; x < rays_count; x++)
+            cast_column(board, columns, x);
+        return;
+    }
+
+    cast_column(board, columns, 0);
+    if (rays_count > 1)
+    {
+        cast_column(board, columns, rays_count - 1);
+        fill_span(board, columns, 0, rays_count - 1, max_span);
+    }
+}
+
+FrameVector<Collision>
+find_collisions(const Board &board, const Vector2 &pos, float radius)
+{
+    float radius_sqr = radius * radius;
+    FrameVector<Collision> collisions;
+    collisions.reserve(8);
+    CellPos cell = CellPos(get_cell(pos));
+
+    for (int i = -1; i <= 1; i++)
+    {
+        for (int j = -1; j <= 1; j++)
+        {
+            if (i == 0 && j == 0) continue;
+            CellPos neighbour(cell.x + i, cell.y + j);
+            if (!board.contains(neighbour)) continue;
+            if (board.at(neighbour) == 0) continue;
+
+            Vector2 collision = pos;
+            if (neighbour.x < cell.x)
+                collision.x = cell.x * 1.0f * cell_size;
+            else if (neighbour.x > cell.x)
+                collision.x = cell.x * 1.0f * cell_size + cell_size;
+
+            if (neighbour.y < cell.y)
+                collision.y = cell.y * 1.0f * cell_size;
+            else if (neighbour.y > cell.y)
+                collision.y = cell.y * 1.0f * cell_size + cell_size;
+
+            if (Vector2LengthSqr(collision - pos) <= radius_sqr)
+            {
+                collisions.push_back(Collision {
+                    collision,
+                    neighbour,
+                });
+            }
+        }
+    }
+
+    return collisions;
+}
+
+void
+find_path(const Board &board, Vector2 from, Vector2 to, std::vector<CellPos> &path)
+{
+    CellPos cell0(from / cell_size);
+    CellPos cell_fin(to / cell_size);
+    path.clear();
+
+    ArenaScope scope;
+    FrameSet<CellPos, hash_fn> visited;
+    FrameMap<CellPos, CellPos, hash_fn> trace;
+    FrameSet<CellPos, hash_fn> front = { cell0 };
+
+    bool found = false;
+    while (!found)
+    {
+        // the target is unreachable, stay in place
+        if (front.empty())
+        {
+            path.push_back(cell0);
+            return;
+        }
+
+        CellPos cur;
+        int heuristic = INT_MAX;
+        for (auto &cell : front)
+        {
+            int h = std::abs(cell.x - cell_fin.x) + std::abs(cell.y - cell_fin.y);
+            if (h < heuristic)
+            {
+                heuristic = h;
+                cur = cell;
+            }
+        }
+
+        front.erase(cur);
+        visited.insert(cur);
+
+        const CellPos neighbours[] = {
+            CellPos(cur.x - 1, cur.y),
+            CellPos(cur.x + 1, cur.y),
+            CellPos(cur.x, cur.y - 1),
+            CellPos(cur.x, cur.y + 1),
+        };
+
+        for (auto &neighbour : neighbours)
+        {
+            if (neighbour == cell_fin)
+            {
+                trace[neighbour] = cur;
+                found = true;
+                break;
+            }
+            else if (board.contains(neighbour) &&
+                     board.at(neighbour) == 0 &&
+                     visited.find(neighbour) == visited.end())
+            {
+                front.insert(neighbour);
+                trace[neighbour] = cur;
+            }
+        }
+    }
+
+    CellPos tracer = cell_fin;
+    while (tracer != cell0)
+    {
+        path.push_back(tracer);
+        tracer = trace.at(tracer);
+    }
+    path.push_back(cell0);
+
+    std::reverse(path.begin(), path.end());
+}
@@ -0,0 +1,80 @@
+#ifndef RAYCAST_HPP
+#define RAYCAST_HPP
+
+#include "board.hpp"
+#include "frame_arena.hpp"
+#include "world.hpp"
+#include <vector>
+
+enum WallFace : uint8_t {
+    FACE_WEST,
+    FACE_EAST,
+    FACE_NORTH,
+    FACE_SOUTH,
+};
+
+// What cast_view found in every screen column, one array per field so each
+// pass streams only what it reads. Rays are scaled to advance one unit along
+// the view direction, which makes the floor a multiply-add per row.
+struct ColumnBuffer {
+    int count = 0;
+    Vector2 origin = { 0, 0 };
+    Vector2 forward = { 1, 0 };
+    Vector2 right = { 0, 1 };
+
+    // Columns sit evenly on a camera plane one unit ahead; plane[x] is the
+    // offset of column x along `right`. Only rebuilt when fov or count change.
+    float fov = 0;
+    float plane_half = 0; // tan(fov / 2), the offset of the view edges
+    std::vector<float> plane;
+
+    std::vector<float> ray_x;
+    std::vector<float> ray_y;
+    std::vector<float> perp_dist; // along forward, world units
+    std::vector<float> tex_u;     // [0, 1) across the face
+    std::vector<uint8_t> tex_id;  // board value of the cell hit
+    std::vector<uint8_t> face;    // WallFace of that cell
+    std::vector<CellPos> cell;
+    int rays_cast = 0; // by the last cast_view
+
+    void reserve(int n);
+    void resize(int n);
+    void build_plane(float fov);
+    // Places the camera at the player, resizing and rebuilding the plane
+    // table when needed; cast_view and friends start with this
+    void set_camera(const Player &player, float fov, int n);
+    // Column x sees `face` of `cell` at hit_pos along `ray`
+    void store(int x, Vector2 ray, Vector2 hit_pos, CellPos cell, uint8_t face, uint8_t id);
+
+    // Screen column of a point `lateral` to the right and `depth` ahead
+    float project(float lateral, float depth) const
+    {
+        return (lateral / (depth * plane_half) + 1) * 0.5f * count - 0.5f;
+    }
+
+    Vector2 hit_pos(int x) const
+    {
+        return origin + Vector2 { ray_x[x], ray_y[x] } * perp_dist[x];
+    }
+};
+
+RayHit
+cast_ray(const Board &board, Vector2 pos, Vector2 dir);
+
+// One ray direction per column: the plane table turned by the player's
+// rotation, one cos and sin per call. With max_span > 1 rays are only cast
+// at the edges of wall spans up to max_span columns wide and the columns in
+// between are solved against the wall's face.
+void
+cast_view(const Board &board, const Player &player, float fov, int rays_count,
+          ColumnBuffer &columns, int max_span = 1);
+
+FrameVector<Collision>
+find_collisions(const Board &board, const Vector2 &pos, float radius);
+
+// Cells from `from` to `to`, both included. Scratch space comes from the
+// frame arena; the path reuses the caller's vector.
+void
+find_path(const Board &board, Vector2 from, Vector2 to, std::vector<CellPos> &path);
+
+#endif // RAYCAST_HPP
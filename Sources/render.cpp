@@ -0,0 +1,473 @@
+#include "render.hpp"
+#include "jobs.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <array>
+#include <utility>
+
+// Columns per job; every column is written by exactly one job
+const int column_grain = 16;
+
+void
+Framebuffer::reserve(int w, int h)
+{
+    pixels.reserve(size_t(w) * h);
+}
+
+void
+Framebuffer::resize(int w, int h)
+{
+    width = w;
+    height = h;
+    x_step = order == PixelOrder::Rows ? 1 : size_t(h);
+    y_step = order == PixelOrder::Rows ? size_t(w) : 1;
+    pixels.assign(size_t(w) * h, BLACK);
+}
+
+const char *
+render_feature_name(RenderFeature feature)
+{
+    switch (feature)
+    {
+    case RENDER_SHADING:      return "shading";
+    case RENDER_FOG:          return "fog";
+    case RENDER_TRANSPARENCY: return "transparency";
+    case RENDER_DEBUG:        return "depth debug";
+    default:                  break;
+    }
+    return "unknown";
+}
+
+static Image
+load_texture_image(const std::string &path)
+{
+    Image image = LoadImage(path);
+    if (image.data == nullptr)
+        return GenImageChecked(64, 64, 8, 8, MAGENTA, BLACK);
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    return image;
+}
+
+RenderAssets
+load_render_assets(const std::string &dir)
+{
+    const char *files[] = {
+        "TECH_1A.png", // NULL
+        "TECH_1A.png",
+        "SUPPORT_3.png",
+        "FLOOR_1A.png",
+        "LIGHT_1C.png",
+    };
+    const int count = sizeof(files) / sizeof(files[0]);
+
+    // decoded on the job workers, one file each
+    Image images[count];
+    jobs.parallel_for(0, count, 1, [&](int begin, int end) {
+        for (int i = begin; i < end; i++)
+            images[i] = load_texture_image(dir + "/" + files[i]);
+    });
+
+    RenderAssets assets;
+    assets.walls = { images[0], images[1], images[2] };
+    assets.floor = images[3];
+    assets.ceiling = images[4];
+    return assets;
+}
+
+static Color
+sample_uv(const Image &img, const Vector2 uv)
+{
+    int tx = int(img.width * uv.x);
+    int ty = int(img.height * uv.y);
+    Color *color_data = (Color *) img.data;
+    return color_data[img.width * ty + tx];
+}
+
+static Color
+blend_colors(Color c1, Color c2, float val)
+{
+    Color blend = (c1 * (1.0f - val) + c2 * val);
+    blend.a = c1.a;
+    return blend;
+}
+
+static void
+blend_pixel(Color &dst, Color src)
+{
+    if (src.a == 255)
+        dst = src;
+    else if (src.a != 0)
+        dst = blend_colors(dst, src, src.a / 255.0f);
+}
+
+// Every kernel below is instantiated once per combination of the feature
+// bits, so the texel loops carry no feature tests; the tables map
+// RenderSettings::features to the instantiation.
+template <template <uint8_t> class Kernel, size_t... Features>
+constexpr auto
+make_kernel_table(std::index_sequence<Features...>)
+{
+    return std::array { &Kernel<Features>::run... };
+}
+
+template <template <uint8_t> class Kernel>
+constexpr auto kernel_table = make_kernel_table<Kernel>(
+    std::make_index_sequence<RENDER_FEATURE_COMBINATIONS>());
+
+// What the features do to texels at one distance, worked out once per
+// column or row
+struct DistanceTint {
+    float shade; // toward black
+    float fog;   // toward the fog colour
+    Color debug;
+};
+
+template <uint8_t Features>
+static DistanceTint
+tint_at([[maybe_unused]] float dist, [[maybe_unused]] const RenderSettings &settings)
+{
+    DistanceTint tint = { 0, 0, BLANK };
+    if constexpr ((Features & RENDER_SHADING) != 0)
+    {
+        float shade = dist / settings.light_dist;
+        tint.shade = std::min(shade * shade, 1.0f);
+    }
+    if constexpr ((Features & RENDER_FOG) != 0)
+        tint.fog = std::min(dist / settings.fog_dist, 1.0f);
+    if constexpr ((Features & RENDER_DEBUG) != 0)
+    {
+        // red up close to blue at the far end of the light
+        float t = std::min(dist / (settings.light_dist * 4), 1.0f);
+        tint.debug = ColorFromHSV(240 * t, 0.8f, 1.0f);
+    }
+    return tint;
+}
+
+template <uint8_t Features>
+static Color
+apply_tint(Color pixel, [[maybe_unused]] const DistanceTint &tint,
+           [[maybe_unused]] const RenderSettings &settings)
+{
+    if constexpr ((Features & RENDER_DEBUG) != 0)
+        pixel = Color { tint.debug.r, tint.debug.g, tint.debug.b, pixel.a };
+    if constexpr ((Features & RENDER_SHADING) != 0)
+        pixel = blend_colors(pixel, BLACK, tint.shade);
+    if constexpr ((Features & RENDER_FOG) != 0)
+        pixel = blend_colors(pixel, settings.fog_color, tint.fog);
+    return pixel;
+}
+
+template <uint8_t Features>
+struct TintKernel {
+    static Color run(Color pixel, float dist, const RenderSettings &settings)
+    {
+        return apply_tint<Features>(pixel, tint_at<Features>(dist, settings), settings);
+    }
+};
+
+Color
+tint_pixel(Color pixel, float dist, const RenderSettings &settings)
+{
+    auto kernel = kernel_table<TintKernel>[settings.features & RENDER_FEATURE_MASK];
+    return kernel(pixel, dist, settings);
+}
+
+template <uint8_t Features>
+static void
+wall_column(Framebuffer &fb, int x, float dist, const Image &image, int tex_x,
+            const RenderSettings &settings)
+{
+    float rect_h = (cell_size * fb.height) / dist;
+    float rect_y = (fb.height - rect_h) / 2;
+    int y0 = std::max(int(std::ceil(rect_y)), 0);
+    int y1 = std::min(int(std::ceil(rect_y + rect_h)), fb.height);
+    if (y0 >= y1)
+        return;
+
+    const Color *texels = (const Color *) image.data + tex_x;
+    float tex_step = image.height / rect_h;
+    float tex_y = (y0 - rect_y) * tex_step;
+    DistanceTint tint = tint_at<Features>(dist, settings);
+
+    Color *dst = &fb.at(x, y0);
+    for (int y = y0; y < y1; ++y)
+    {
+        int ty = std::min(int(tex_y), image.height - 1);
+        *dst = apply_tint<Features>(texels[ty * image.width], tint, settings);
+        dst += fb.y_step;
+        tex_y += tex_step;
+    }
+}
+
+template <uint8_t Features>
+struct WallColumnKernel {
+    static void run(Framebuffer &fb, int x, float dist, const Image &image, int tex_x,
+                    const RenderSettings &settings)
+    {
+        wall_column<Features>(fb, x, dist, image, tex_x, settings);
+    }
+};
+
+void
+draw_wall_column(Framebuffer &fb, int x, float dist, const Image &image,
+                 int tex_x, const RenderSettings &settings)
+{
+    auto kernel = kernel_table<WallColumnKernel>[settings.features & RENDER_FEATURE_MASK];
+    kernel(fb, x, dist, image, tex_x, settings);
+}
+
+template <uint8_t Features>
+struct FloorKernel {
+    static void run(Framebuffer &fb,
+                    const ColumnBuffer &columns,
+                    const RenderAssets &assets,
+                    const RenderSettings &settings,
+                    int x0, int x1);
+};
+
+template <uint8_t Features>
+void
+FloorKernel<Features>::run(Framebuffer &fb,
+                           const ColumnBuffer &columns,
+                           const RenderAssets &assets,
+                           const RenderSettings &settings,
+                           int x0, int x1)
+{
+    // rounded up so an odd height has its middle row covered, by the floor
+    int horizon = (fb.height + 1) / 2;
+    float cam_height = 0.5f * fb.height;
+    Vector2 origin = columns.origin / cell_size;
+
+    for (int x = x0; x < x1; x++)
+    {
+        Vector2 ray = { columns.ray_x[x], columns.ray_y[x] };
+        for (int y = 0; y < horizon; y += settings.floor_step)
+        {
+            float row_dist = cam_height / (horizon - y);
+            Vector2 floor_pos = origin + ray * row_dist;
+            Vector2 cell = Vector2 {
+                std::floor(floor_pos.x),
+                std::floor(floor_pos.y),
+            };
+            Vector2 uv = floor_pos - cell;
+
+            DistanceTint tint = tint_at<Features>(row_dist * cell_size, settings);
+            Color floor_pix = apply_tint<Features>(sample_uv(assets.floor, uv), tint, settings);
+            Color ceiling_pix = apply_tint<Features>(sample_uv(assets.ceiling, uv), tint,
+                                                     settings);
+
+            int rows = std::min(settings.floor_step, horizon - y);
+            for (int k = 0; k < rows; k++)
+            {
+                fb.at(x, y + k) = ceiling_pix;
+                fb.at(x, fb.height - 1 - y - k) = floor_pix;
+            }
+        }
+    }
+}
+
+void
+render_floor(Framebuffer &fb,
+             const ColumnBuffer &columns,
+             const RenderAssets &assets,
+             const RenderSettings &settings)
+{
+    int count = std::min(columns.count, fb.width);
+    auto kernel = kernel_table<FloorKernel>[settings.features & RENDER_FEATURE_MASK];
+    jobs.parallel_for(0, count, column_grain, [&](int x0, int x1) {
+        kernel(fb, columns, assets, settings, x0, x1);
+    });
+}
+
+template <uint8_t Features>
+struct WallKernel {
+    static void run(Framebuffer &fb,
+                    const ColumnBuffer &columns,
+                    const RenderAssets &assets,
+                    const RenderSettings &settings,
+                    int x0, int x1)
+    {
+        for (int x = x0; x < x1; x++)
+        {
+            const Image &image = assets.walls[columns.tex_id[x]];
+            int tex_x = int(columns.tex_u[x] * image.width);
+            wall_column<Features>(fb, x, columns.perp_dist[x], image, tex_x, settings);
+        }
+    }
+};
+
+void
+render_walls(Framebuffer &fb,
+             const ColumnBuffer &columns,
+             const RenderAssets &assets,
+             const RenderSettings &settings)
+{
+    int count = std::min(columns.count, fb.width);
+    auto kernel = kernel_table<WallKernel>[settings.features & RENDER_FEATURE_MASK];
+    jobs.parallel_for(0, count, column_grain, [&](int x0, int x1) {
+        kernel(fb, columns, assets, settings, x0, x1);
+    });
+}
+
+FrameVector<size_t>
+get_render_order(const Player &player, const std::vector<Object> &objects)
+{
+    FrameVector<std::pair<float, size_t>> distances;
+    distances.reserve(objects.size());
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        float dist = Vector2LengthSqr(objects[i].pos - player.pos);
+        distances.emplace_back(dist, i);
+    }
+    std::sort(distances.begin(), distances.end(), std::greater<>());
+
+    FrameVector<size_t> order;
+    order.reserve(distances.size());
+    for (auto &p : distances)
+        order.push_back(p.second);
+    return order;
+}
+
+bool
+project_sprite(int width, int height, const ColumnBuffer &columns, const Object &object,
+               SpriteProjection &p)
+{
+    if (object.image.data == nullptr)
+        return false;
+
+    // sprites are billboards one cell wide facing the camera
+    Vector2 to_object = object.pos - columns.origin;
+    p.depth = Vector2DotProduct(to_object, columns.forward);
+    if (p.depth < 1)
+        return false;
+
+    float lateral = Vector2DotProduct(to_object, columns.right);
+    p.x_start = columns.project(lateral - cell_size / 2.0f, p.depth);
+    p.x_end = columns.project(lateral + cell_size / 2.0f, p.depth);
+    if (p.x_end < 0 || p.x_start >= width)
+        return false;
+
+    p.rect_h = (cell_size * height) / p.depth;
+    p.rect_y = (height - p.rect_h) / 2;
+    p.bounds.x0 = std::max(int(std::ceil(p.x_start)), 0);
+    p.bounds.x1 = std::min(int(std::ceil(p.x_end)), std::min(columns.count, width));
+    p.bounds.y0 = std::max(int(std::ceil(p.rect_y)), 0);
+    p.bounds.y1 = std::min(int(std::ceil(p.rect_y + p.rect_h)), height);
+    return p.bounds.x0 < p.bounds.x1 && p.bounds.y0 < p.bounds.y1;
+}
+
+SpriteBounds
+sprite_bounds(const Framebuffer &fb, const ColumnBuffer &columns, const Object &object)
+{
+    SpriteProjection p;
+    if (!project_sprite(fb.width, fb.height, columns, object, p))
+        return SpriteBounds { 0, 0, 0, 0 };
+    return p.bounds;
+}
+
+// Columns [x0, x1) of one projected sprite
+template <uint8_t Features>
+struct SpriteKernel {
+    static void run(Framebuffer &fb,
+                    const ColumnBuffer &columns,
+                    const Object &object,
+                    const SpriteProjection &p,
+                    const RenderSettings &settings,
+                    const RenderClip *clip,
+                    int x0, int x1);
+};
+
+template <uint8_t Features>
+void
+SpriteKernel<Features>::run(Framebuffer &fb,
+                            const ColumnBuffer &columns,
+                            const Object &object,
+                            const SpriteProjection &p,
+                            const RenderSettings &settings,
+                            const RenderClip *clip,
+                            int x0, int x1)
+{
+    int y0 = p.bounds.y0;
+    int y1 = p.bounds.y1;
+    if (clip)
+    {
+        y0 = std::max(y0, clip->y0);
+        y1 = std::min(y1, clip->y1);
+    }
+    float tex_step = object.image.height / p.rect_h;
+    DistanceTint tint = tint_at<Features>(p.depth, settings);
+
+    const Color *texels = (const Color *) object.image.data;
+    for (int x = std::max(x0, p.bounds.x0); x < std::min(x1, p.bounds.x1); x++)
+    {
+        if (p.depth >= columns.perp_dist[x] || (clip && !clip->columns[x]))
+            continue;
+
+        float u = (x - p.x_start) / (p.x_end - p.x_start);
+        int col = std::clamp(int(u * object.image.width), 0, object.image.width - 1);
+        float tex_y = (y0 - p.rect_y) * tex_step;
+        for (int y = y0; y < y1; y++)
+        {
+            int ty = std::min(int(tex_y), object.image.height - 1);
+            Color pixel = apply_tint<Features>(texels[ty * object.image.width + col], tint,
+                                               settings);
+            if constexpr ((Features & RENDER_TRANSPARENCY) != 0)
+                blend_pixel(fb.at(x, y), pixel);
+            else if (pixel.a >= 128)
+                fb.at(x, y) = Color { pixel.r, pixel.g, pixel.b, 255 };
+            tex_y += tex_step;
+        }
+    }
+}
+
+void
+render_sprites(Framebuffer &fb,
+               const Player &player,
+               const ColumnBuffer &columns,
+               const std::vector<Object> &objects,
+               const RenderSettings &settings,
+               const RenderClip *clip)
+{
+    ArenaScope scope;
+    FrameVector<size_t> render_order = get_render_order(player, objects);
+
+    // projected once, far to near; each band of columns then draws its
+    // slice of every sprite in that order
+    FrameVector<std::pair<size_t, SpriteProjection>> visible;
+    visible.reserve(render_order.size());
+    for (size_t i : render_order)
+    {
+        SpriteProjection p;
+        if (project_sprite(fb.width, fb.height, columns, objects[i], p))
+            visible.emplace_back(i, p);
+    }
+
+    int count = std::min(columns.count, fb.width);
+    auto kernel = kernel_table<SpriteKernel>[settings.features & RENDER_FEATURE_MASK];
+    jobs.parallel_for(0, count, column_grain, [&](int x0, int x1) {
+        for (auto &[i, p] : visible)
+            kernel(fb, columns, objects[i], p, settings, clip, x0, x1);
+    });
+}
+
+void
+render_view(Framebuffer &fb,
+            const Player &player,
+            const ColumnBuffer &columns,
+            const std::vector<Object> &objects,
+            const RenderAssets &assets,
+            const RenderSettings &settings)
+{
+    {
+        PROFILE_SCOPE(Stage::FloorCeiling);
+        render_floor(fb, columns, assets, settings);
+    }
+    {
+        PROFILE_SCOPE(Stage::Walls);
+        render_walls(fb, columns, assets, settings);
+    }
+    {
+        PROFILE_SCOPE(Stage::Sprites);
+        render_sprites(fb, player, columns, objects, settings);
+    }
+}
@@ -0,0 +1,137 @@
+#ifndef RENDER_HPP
+#define RENDER_HPP
+
+#include "board.hpp"
+#include "frame_arena.hpp"
+#include "raycast.hpp"
+#include "world.hpp"
+#include <string>
+#include <vector>
+
+enum class PixelOrder : uint8_t {
+    Rows,    // row after row, as textures and the screen want them
+    Columns, // column after column, as the wall and sprite passes write them
+};
+
+// CPU side frame. Every ray owns one column; the presenter stretches the
+// frame over the window. Column order keeps a column fill inside a few
+// cache lines; post_process transposes such frames back to rows.
+struct Framebuffer {
+    int width = 0;
+    int height = 0;
+    PixelOrder order = PixelOrder::Rows; // takes effect on the next resize
+    std::vector<Color> pixels;
+    // from (x, y) to (x + 1, y) and to (x, y + 1)
+    size_t x_step = 1;
+    size_t y_step = 0;
+
+    // Sizes up to w x h afterwards reuse the storage, no reallocation
+    void reserve(int w, int h);
+    void resize(int w, int h);
+
+    // Row order only
+    Color *row(int y) { return pixels.data() + size_t(y) * width; }
+    size_t index(int x, int y) const { return x * x_step + y * y_step; }
+    Color &at(int x, int y) { return pixels[index(x, y)]; }
+};
+
+struct RenderAssets {
+    std::vector<Image> walls; // indexed by board cell value
+    Image floor;
+    Image ceiling;
+};
+
+// Switchable at runtime; each combination has its own kernels
+enum RenderFeature : uint8_t {
+    RENDER_SHADING      = 1 << 0, // darker with distance
+    RENDER_FOG          = 1 << 1, // toward fog_color with distance
+    RENDER_TRANSPARENCY = 1 << 2, // sprites blend by alpha, else cut out at half
+    RENDER_DEBUG        = 1 << 3, // texels coloured by distance
+    RENDER_FEATURE_COMBINATIONS = 1 << 4,
+    RENDER_FEATURE_MASK = RENDER_FEATURE_COMBINATIONS - 1,
+};
+
+const char *
+render_feature_name(RenderFeature feature);
+
+struct RenderSettings {
+    float fov;
+    int floor_step = 3; // floor and ceiling rows sharing one sample
+    float light_dist = 200.0f;
+    uint8_t features = RENDER_TRANSPARENCY;
+    Color fog_color = { 96, 96, 112, 255 };
+    float fog_dist = 800.0f;
+};
+
+// Loads the textures under dir, missing files are replaced by a checker
+RenderAssets
+load_render_assets(const std::string &dir);
+
+// A texel dist away as the kernels colour it
+Color
+tint_pixel(Color pixel, float dist, const RenderSettings &settings);
+
+void
+draw_wall_column(Framebuffer &fb, int x, float dist, const Image &image,
+                 int tex_x, const RenderSettings &settings);
+
+void
+render_floor(Framebuffer &fb,
+             const ColumnBuffer &columns,
+             const RenderAssets &assets,
+             const RenderSettings &settings);
+
+void
+render_walls(Framebuffer &fb,
+             const ColumnBuffer &columns,
+             const RenderAssets &assets,
+             const RenderSettings &settings);
+
+// Screen rectangle [x0, x1) x [y0, y1) a sprite covers, empty when unseen
+struct SpriteBounds {
+    int x0, x1;
+    int y0, y1;
+};
+
+SpriteBounds
+sprite_bounds(const Framebuffer &fb, const ColumnBuffer &columns, const Object &object);
+
+struct SpriteProjection {
+    float depth;
+    float x_start, x_end; // screen columns of the billboard's edges
+    float rect_y, rect_h;
+    SpriteBounds bounds;
+};
+
+// False when the sprite is behind the camera or off a width x height view
+bool
+project_sprite(int width, int height, const ColumnBuffer &columns, const Object &object,
+               SpriteProjection &p);
+
+// Limits drawing to the marked columns and rows [y0, y1)
+struct RenderClip {
+    const uint8_t *columns;
+    int y0, y1;
+};
+
+// Sprites are hidden behind walls closer than them along the view direction
+void
+render_sprites(Framebuffer &fb,
+               const Player &player,
+               const ColumnBuffer &columns,
+               const std::vector<Object> &objects,
+               const RenderSettings &settings,
+               const RenderClip *clip = nullptr);
+
+void
+render_view(Framebuffer &fb,
+            const Player &player,
+            const ColumnBuffer &columns,
+            const std::vector<Object> &objects,
+            const RenderAssets &assets,
+            const RenderSettings &settings);
+
+FrameVector<size_t>
+get_render_order(const Player &player, const std::vector<Object> &objects);
+
+#endif // RENDER_HPP
@@ -0,0 +1,57 @@
+#include "resolution.hpp"
+#include <algorithm>
+#include <cmath>
+
+ResolutionController::ResolutionController(const ResolutionSettings &settings,
+                                           int max_columns)
+    : settings(settings), max_columns(max_columns), current_columns(max_columns),
+      current_floor_step(settings.base_floor_step)
+{
+}
+
+int
+ResolutionController::columns_for(float scale) const
+{
+    // multiples of 8 keep row ends aligned for the wide kernels
+    int columns = int(std::lround(max_columns * scale / 8)) * 8;
+    return std::clamp(columns, 8, max_columns);
+}
+
+bool
+ResolutionController::update(float frame_ms)
+{
+    smoothed = smoothed == 0 ? frame_ms
+                             : smoothed + (frame_ms - smoothed) * settings.smoothing;
+    if (cooldown > 0)
+    {
+        cooldown--;
+        return false;
+    }
+
+    const float over = settings.target_ms * 1.05f;
+    const float under = settings.target_ms * 0.85f;
+    int old_columns = current_columns;
+    int old_floor_step = current_floor_step;
+
+    if (smoothed > over)
+    {
+        if (current_floor_step < settings.max_floor_step)
+            current_floor_step++;
+        else
+            current_scale = std::max(settings.min_scale,
+                              current_scale * std::max(settings.target_ms / smoothed, 0.8f));
+    }
+    else if (smoothed < under)
+    {
+        if (current_scale < 1.0f)
+            current_scale = std::min(1.0f, current_scale * std::min(settings.target_ms / smoothed, 1.1f));
+        else if (current_floor_step > settings.base_floor_step)
+            current_floor_step--;
+    }
+
+    current_columns = columns_for(current_scale);
+    if (current_columns == old_columns && current_floor_step == old_floor_step)
+        return false;
+    cooldown = settings.cooldown_frames;
+    return true;
+}
@@ -0,0 +1,42 @@
+#ifndef RESOLUTION_HPP
+#define RESOLUTION_HPP
+
+struct ResolutionSettings {
+    float target_ms = 1000.0f / 60;
+    float smoothing = 0.1f;   // weight of the newest frame in the average
+    float min_scale = 0.25f;  // of the full ray count
+    int base_floor_step = 3;  // floor rows per sample at full quality
+    int max_floor_step = 6;
+    int cooldown_frames = 15; // frames between two changes
+};
+
+// Trades resolution for frame time. Over budget the floor gets coarser
+// first, then the ray count drops; under budget quality comes back in the
+// opposite order. Changes wait for the smoothed time to leave a dead band
+// around the target so the picture doesn't pump.
+class ResolutionController
+{
+public:
+    ResolutionController(const ResolutionSettings &settings, int max_columns);
+
+    // Returns true when columns() or floor_step() changed
+    bool update(float frame_ms);
+
+    float scale() const { return current_scale; }
+    int columns() const { return current_columns; }
+    int floor_step() const { return current_floor_step; }
+    float smoothed_ms() const { return smoothed; }
+
+private:
+    int columns_for(float scale) const;
+
+    ResolutionSettings settings;
+    int max_columns;
+    float current_scale = 1.0f;
+    int current_columns;
+    int current_floor_step;
+    float smoothed = 0;
+    int cooldown = 0;
+};
+
+#endif // RESOLUTION_HPP
@@ -0,0 +1,293 @@
+#include "scene.hpp"
+#include <algorithm>
+
+namespace {
+
+const int room_w = 8;
+const int room_h = 9;
+
+const int room[room_w][room_h] = {
+    { 1, 1, 1, 1, 1, 1, 1, 1, 1 },
+    { 1, 0, 0, 0, 0, 0, 0, 0, 1 },
+    { 1, 0, 2, 0, 0, 0, 1, 0, 1 },
+    { 1, 2, 2, 0, 0, 0, 0, 0, 1 },
+    { 1, 0, 0, 0, 0, 0, 0, 0, 1 },
+    { 1, 0, 0, 0, 0, 0, 0, 0, 1 },
+    { 1, 0, 1, 0, 0, 0, 0, 0, 1 },
+    { 1, 1, 1, 1, 1, 1, 1, 1, 1 },
+};
+
+// splitmix64, the standard distributions differ between library vendors
+struct SceneRng {
+    uint64_t state;
+
+    explicit SceneRng(uint64_t seed) : state(seed) {}
+
+    uint32_t next()
+    {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return uint32_t((z ^ (z >> 31)) >> 32);
+    }
+
+    // integer in [lo, hi)
+    int range(int lo, int hi)
+    {
+        return lo + int(next() % uint32_t(hi - lo));
+    }
+
+    bool chance(float p)
+    {
+        return (next() >> 8) < uint32_t(p * (1 << 24));
+    }
+};
+
+struct Grid {
+    int w, h;
+    std::vector<uint8_t> cells;
+
+    Grid(int w, int h, uint8_t fill) : w(w), h(h), cells(size_t(w) * h, fill) {}
+
+    uint8_t &at(int x, int y) { return cells[size_t(y) * w + x]; }
+
+    void border(uint8_t value)
+    {
+        for (int x = 0; x < w; x++)
+            at(x, 0) = at(x, h - 1) = value;
+        for (int y = 0; y < h; y++)
+            at(0, y) = at(w - 1, y) = value;
+    }
+};
+
+uint8_t
+wall_texture(SceneRng &rng)
+{
+    return rng.range(1, 3);
+}
+
+// recursive backtracker over the odd cells
+void
+carve_maze(Grid &grid, SceneRng &rng)
+{
+    for (auto &c : grid.cells)
+        c = wall_texture(rng);
+
+    std::vector<CellPos> stack = { CellPos(1, 1) };
+    grid.at(1, 1) = 0;
+    while (!stack.empty())
+    {
+        CellPos cur = stack.back();
+        CellPos options[4];
+        int count = 0;
+        const CellPos steps[4] = { {2, 0}, {-2, 0}, {0, 2}, {0, -2} };
+        for (auto &step : steps)
+        {
+            CellPos next(cur.x + step.x, cur.y + step.y);
+            if (next.x > 0 && next.x < grid.w - 1 &&
+                next.y > 0 && next.y < grid.h - 1 &&
+                grid.at(next.x, next.y) != 0)
+                options[count++] = next;
+        }
+        if (count == 0)
+        {
+            stack.pop_back();
+            continue;
+        }
+        CellPos next = options[rng.range(0, count)];
+        grid.at((cur.x + next.x) / 2, (cur.y + next.y) / 2) = 0;
+        grid.at(next.x, next.y) = 0;
+        stack.push_back(next);
+    }
+}
+
+void
+build_arena(Grid &grid, SceneRng &rng)
+{
+    grid.border(1);
+    // sparse 2x2 cover blocks
+    for (int y = 4; y < grid.h - 5; y += 8)
+    {
+        for (int x = 4; x < grid.w - 5; x += 8)
+        {
+            if (!rng.chance(0.2f))
+                continue;
+            uint8_t tex = wall_texture(rng);
+            int bx = x + rng.range(0, 3);
+            int by = y + rng.range(0, 3);
+            grid.at(bx, by) = grid.at(bx + 1, by) = tex;
+            grid.at(bx, by + 1) = grid.at(bx + 1, by + 1) = tex;
+        }
+    }
+}
+
+void
+build_corridors(Grid &grid, SceneRng &rng)
+{
+    for (auto &c : grid.cells)
+        c = 1;
+    // long east-west corridors joined by a few north-south cuts
+    for (int y = 1; y < grid.h - 1; y += 4)
+    {
+        for (int x = 1; x < grid.w - 1; x++)
+            grid.at(x, y) = 0;
+        if (y + 4 >= grid.h - 1)
+            break;
+        int cuts = std::max(1, grid.w / 32);
+        for (int i = 0; i < cuts; i++)
+        {
+            int x = rng.range(1, grid.w - 1);
+            for (int k = 1; k < 4; k++)
+                grid.at(x, y + k) = 0;
+        }
+        for (int x = 0; x < grid.w; x++)
+            for (int k = 1; k < 4; k++)
+                if (grid.at(x, y + k) != 0)
+                    grid.at(x, y + k) = wall_texture(rng);
+    }
+}
+
+void
+build_pillars(Grid &grid, SceneRng &rng)
+{
+    grid.border(1);
+    for (int y = 2; y < grid.h - 2; y += 2)
+        for (int x = 2; x < grid.w - 2; x += 2)
+            if (rng.chance(0.3f))
+                grid.at(x, y) = wall_texture(rng);
+}
+
+CellPos
+find_empty_cell(Grid &grid, SceneRng &rng)
+{
+    for (int attempt = 0; attempt < 1000; attempt++)
+    {
+        CellPos cell(rng.range(1, grid.w - 1), rng.range(1, grid.h - 1));
+        if (grid.at(cell.x, cell.y) == 0)
+            return cell;
+    }
+    for (int y = 1; y < grid.h - 1; y++)
+        for (int x = 1; x < grid.w - 1; x++)
+            if (grid.at(x, y) == 0)
+                return CellPos(x, y);
+    return CellPos(1, 1);
+}
+
+Vector2
+cell_center(CellPos cell)
+{
+    return {
+        (cell.x + 0.5f) * cell_size,
+        (cell.y + 0.5f) * cell_size,
+    };
+}
+
+Scene
+room_scene(const SceneParams &params, const std::vector<Image> &sprite_images)
+{
+    Scene scene;
+    scene.board = make_board(
+        params.backend, room_w, room_h,
+        [](int x, int y) { return room[x][y]; }
+    );
+
+    scene.player.pos = { 5.0f * cell_size, 5.0f * cell_size };
+    scene.player.speed = 150;
+    scene.player.rotation = 0;
+
+    const Vector2 positions[] = {
+        { 3 * cell_size, 5 * cell_size },
+        { 3 * cell_size, 4 * cell_size },
+        { 2 * cell_size, 2 * cell_size },
+    };
+    for (size_t i = 0; i < 3; i++)
+    {
+        Object object;
+        object.pos = positions[i];
+        if (!sprite_images.empty())
+            object.image = sprite_images[i % sprite_images.size()];
+        scene.objects.push_back(object);
+    }
+    return scene;
+}
+
+}
+
+Scene
+generate_scene(const SceneParams &params,
+               const std::vector<Image> &sprite_images)
+{
+    if (params.kind == SceneKind::Room)
+        return room_scene(params, sprite_images);
+
+    SceneRng rng(params.seed);
+    int w = std::max(params.width, 5);
+    int h = std::max(params.height, 5);
+    // mazes need odd sides so that the outer wall is closed
+    if (params.kind == SceneKind::Maze)
+    {
+        w |= 1;
+        h |= 1;
+    }
+    Grid grid(w, h, 0);
+    switch (params.kind)
+    {
+    case SceneKind::Maze:      carve_maze(grid, rng); break;
+    case SceneKind::Arena:     build_arena(grid, rng); break;
+    case SceneKind::Corridors: build_corridors(grid, rng); break;
+    case SceneKind::Pillars:   build_pillars(grid, rng); break;
+    case SceneKind::Room:      break;
+    }
+
+    Scene scene;
+    scene.player.pos = cell_center(find_empty_cell(grid, rng));
+    scene.player.speed = 150;
+    scene.player.rotation = (rng.next() % 360) * DEG2RAD;
+
+    scene.objects.reserve(params.sprites);
+    for (size_t i = 0; i < params.sprites; i++)
+    {
+        Object object;
+        object.pos = cell_center(find_empty_cell(grid, rng));
+        if (!sprite_images.empty())
+            object.image = sprite_images[i % sprite_images.size()];
+        scene.objects.push_back(object);
+    }
+
+    // the chunked backend keeps reading the source on its loader thread
+    auto cells = std::make_shared<Grid>(std::move(grid));
+    scene.board = make_board(
+        params.backend, w, h,
+        [cells](int x, int y) { return cells->at(x, y); }
+    );
+    return scene;
+}
+
+const char *
+scene_kind_name(SceneKind kind)
+{
+    switch (kind)
+    {
+    case SceneKind::Room:      return "room";
+    case SceneKind::Maze:      return "maze";
+    case SceneKind::Arena:     return "arena";
+    case SceneKind::Corridors: return "corridors";
+    case SceneKind::Pillars:   return "pillars";
+    }
+    return "unknown";
+}
+
+bool
+parse_scene_kind(const std::string &name, SceneKind &kind)
+{
+    for (SceneKind k : { SceneKind::Room, SceneKind::Maze, SceneKind::Arena,
+                         SceneKind::Corridors, SceneKind::Pillars })
+    {
+        if (name == scene_kind_name(k))
+        {
+            kind = k;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,46 @@
+#ifndef SCENE_HPP
+#define SCENE_HPP
+
+#include "board.hpp"
+#include "world.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum class SceneKind {
+    Room,      // the original hand made 8x9 room
+    Maze,
+    Arena,
+    Corridors,
+    Pillars,
+};
+
+struct SceneParams {
+    SceneKind kind = SceneKind::Room;
+    uint32_t seed = 1;
+    int width = 64;  // cells; mazes round up to odd
+    int height = 64;
+    size_t sprites = 3;
+    BoardBackend backend = BoardBackend::Dense;
+};
+
+struct Scene {
+    std::unique_ptr<Board> board;
+    Player player;
+    std::vector<Object> objects;
+};
+
+// Same params and seed give the same scene on every platform. Objects cycle
+// through sprite_images, which may be empty for headless use.
+Scene
+generate_scene(const SceneParams &params,
+               const std::vector<Image> &sprite_images);
+
+const char *
+scene_kind_name(SceneKind kind);
+
+bool
+parse_scene_kind(const std::string &name, SceneKind &kind);
+
+#endif // SCENE_HPP
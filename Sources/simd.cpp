@@ -0,0 +1,43 @@
+#include "simd.hpp"
+#include <algorithm>
+#include <atomic>
+
+static SimdLevel
+detect_level()
+{
+#if SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return SimdLevel::SSE2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+static std::atomic<SimdLevel> level_limit { SimdLevel::AVX2 };
+
+const char *
+simd_level_name(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::Scalar: return "scalar";
+    case SimdLevel::SSE2:   return "sse2";
+    case SimdLevel::AVX2:   return "avx2";
+    }
+    return "unknown";
+}
+
+SimdLevel
+simd_level()
+{
+    static const SimdLevel supported_level = detect_level();
+    return std::min(supported_level, level_limit.load(std::memory_order_relaxed));
+}
+
+void
+simd_limit(SimdLevel level)
+{
+    level_limit.store(level, std::memory_order_relaxed);
+}
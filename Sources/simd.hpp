@@ -0,0 +1,34 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cstdint>
+
+// x86 kernels are compiled per instruction set with target attributes and
+// picked at runtime, so the build needs no -m flags and runs anywhere.
+// Other compilers and CPUs only get the scalar kernels.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#define SIMD_TARGET_SSE2 __attribute__((target("sse2")))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SIMD_X86 0
+#endif
+
+enum class SimdLevel : uint8_t {
+    Scalar,
+    SSE2,
+    AVX2,
+};
+
+const char *
+simd_level_name(SimdLevel level);
+
+// The best the CPU supports, capped by simd_limit
+SimdLevel
+simd_level();
+
+// Caps the kernels picked from now on, to compare them
+void
+simd_limit(SimdLevel level);
+
+#endif // SIMD_HPP
@@ -0,0 +1,143 @@
+#include "simulation.hpp"
+#include "frame_arena.hpp"
+#include "trace.hpp"
+#include <algorithm>
+
+FixedTimestep::FixedTimestep(float step, int max_steps)
+    : step_dt(step), max_steps(max_steps)
+{
+}
+
+int
+FixedTimestep::advance(float frame_dt)
+{
+    accumulator += std::max(frame_dt, 0.0f);
+    int steps = int(accumulator / step_dt);
+    accumulator -= steps * step_dt;
+    if (steps > max_steps)
+        steps = max_steps;
+    return steps;
+}
+
+void
+interpolate_world(const WorldState &previous, const WorldState &current, float alpha,
+                  WorldState &out)
+{
+    out.player = current.player;
+    out.player.pos = Vector2Lerp(previous.player.pos, current.player.pos, alpha);
+
+    out.objects = current.objects;
+    // objects only ever disappear, so both lists are in the same order
+    size_t j = 0;
+    for (Object &object : out.objects)
+    {
+        while (j < previous.objects.size() && previous.objects[j].id != object.id)
+            j++;
+        if (j == previous.objects.size())
+            break;
+        object.pos = Vector2Lerp(previous.objects[j].pos, object.pos, alpha);
+    }
+}
+
+static WorldSnapshot
+first_snapshot(const Board &board, const WorldState &world)
+{
+    WorldSnapshot snapshot;
+    snapshot.previous = world;
+    snapshot.current = world;
+    snapshot.board_revision = board.revision();
+    return snapshot;
+}
+
+Simulation::Simulation(const Board &board, const WorldState &world, float step,
+                       SimulationRules rules, bool threaded)
+    : board(board), rules(std::move(rules)), timestep(step), world(world), previous(world),
+      snapshots(first_snapshot(board, world))
+{
+    if (threaded)
+        thread = std::thread(&Simulation::run, this);
+}
+
+Simulation::~Simulation()
+{
+    if (!thread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    queue_cv.notify_all();
+    thread.join();
+}
+
+void
+Simulation::submit(const InputFrame &input)
+{
+    if (!thread.joinable())
+    {
+        simulate(input);
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        queue_cv.wait(lock, [this] { return queue_count < queue_size; });
+        queue[(queue_head + queue_count) % queue_size] = input;
+        queue_count++;
+    }
+    queue_cv.notify_all();
+}
+
+const WorldSnapshot &
+Simulation::latest()
+{
+    snapshots.update();
+    return snapshots.front();
+}
+
+void
+Simulation::run()
+{
+    trace_thread_name("simulation");
+    while (true)
+    {
+        InputFrame input;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_cv.wait(lock, [this] { return queue_count > 0 || stopping; });
+            if (queue_count == 0)
+                return;
+            input = queue[queue_head];
+            queue_head = (queue_head + 1) % queue_size;
+            queue_count--;
+        }
+        queue_cv.notify_all();
+        simulate(input);
+    }
+}
+
+void
+Simulation::simulate(const InputFrame &input)
+{
+    TRACE_SCOPE("simulate");
+    ArenaScope frame_scope;
+    rules.apply_input(world, input);
+    // frames without a step keep showing what the last one drew
+    int steps = timestep.advance(input.dt);
+    for (int step = 0; step < steps; step++)
+    {
+        previous = world;
+        debug.clear();
+        rules.step(world, input, timestep.step(), debug);
+    }
+    frame++;
+
+    // assigning into the slot reuses what it held two snapshots ago
+    WorldSnapshot &snapshot = snapshots.back();
+    snapshot.previous = previous;
+    snapshot.current = world;
+    snapshot.alpha = timestep.alpha();
+    snapshot.frame = frame;
+    snapshot.board_revision = board.revision();
+    snapshot.debug = debug;
+    snapshots.publish();
+}
@@ -0,0 +1,109 @@
+#ifndef SIMULATION_HPP
+#define SIMULATION_HPP
+
+#include "board.hpp"
+#include "debug_draw.hpp"
+#include "input.hpp"
+#include "triple_buffer.hpp"
+#include "world.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Everything the simulation advances
+struct WorldState {
+    Player player;
+    std::vector<Object> objects;
+};
+
+// Turns variable frame times into whole simulation steps. The time left
+// over is carried to the next frame; alpha() tells how far the present is
+// past the last step.
+class FixedTimestep
+{
+public:
+    // More than max_steps per frame would only fall further behind, the
+    // extra time is dropped instead
+    explicit FixedTimestep(float step, int max_steps = 5);
+
+    int advance(float frame_dt);
+    float alpha() const { return accumulator / step_dt; }
+    float step() const { return step_dt; }
+
+private:
+    float step_dt;
+    int max_steps;
+    float accumulator = 0;
+};
+
+// Positions alpha of the way from previous to current. Objects are matched
+// by id, ones without a previous state are taken as they are. Rotation is
+// the current one, the view follows the mouse without delay.
+void
+interpolate_world(const WorldState &previous, const WorldState &current, float alpha,
+                  WorldState &out);
+
+// One published frame of the simulation, read only by the renderer
+struct WorldSnapshot {
+    WorldState previous;
+    WorldState current;
+    float alpha = 0; // interpolate_world() between the two
+    uint64_t frame = 0; // input frames simulated so far
+    uint64_t board_revision = 0; // the board the steps saw
+    DebugDraw debug; // what the last step drew, for the minimap
+};
+
+// The game itself. apply_input runs once per input frame, step once per
+// fixed step; both on the simulation thread.
+struct SimulationRules {
+    std::function<void(WorldState &world, const InputFrame &input)> apply_input;
+    std::function<void(WorldState &world, const InputFrame &input, float dt,
+                       DebugDraw &debug)> step;
+};
+
+// Runs the rules on its own thread, one submitted input frame at a time, and
+// publishes a snapshot after each through a triple buffer. While the
+// renderer draws one snapshot the next frame is being simulated. submit()
+// only blocks when the simulation falls queue_size frames behind; the board
+// has to stay safe to query from both threads.
+//
+// Unthreaded, submit() simulates the frame right away, which is the old
+// sequential loop.
+class Simulation
+{
+public:
+    Simulation(const Board &board, const WorldState &world, float step,
+               SimulationRules rules, bool threaded);
+    ~Simulation();
+
+    void submit(const InputFrame &input);
+    // The newest complete snapshot, valid until the next call
+    const WorldSnapshot &latest();
+
+private:
+    void run();
+    void simulate(const InputFrame &input);
+
+    const Board &board;
+    SimulationRules rules;
+    FixedTimestep timestep;
+    WorldState world;
+    WorldState previous;
+    DebugDraw debug;
+    uint64_t frame = 0;
+    TripleBuffer<WorldSnapshot> snapshots;
+
+    static constexpr int queue_size = 2;
+    InputFrame queue[queue_size];
+    int queue_head = 0;
+    int queue_count = 0;
+    bool stopping = false;
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::thread thread;
+};
+
+#endif // SIMULATION_HPP
@@ -0,0 +1,160 @@
+#include "trace.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> trace_enabled { false };
+
+namespace {
+
+struct TraceEvent {
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+};
+
+// Single producer ring. The owner bumps head after writing a slot; readers
+// copy a range and then drop whatever the producer may have overwritten.
+struct TraceBuffer {
+    static constexpr size_t capacity = 1 << 16;
+
+    TraceEvent events[capacity];
+    std::atomic<uint64_t> head { 0 };
+    int tid;
+    std::string name;
+};
+
+std::mutex buffers_mutex;
+std::vector<std::unique_ptr<TraceBuffer>> buffers;
+
+const size_t frame_capacity = 1024;
+uint64_t frame_starts[frame_capacity];
+std::atomic<uint64_t> frame_count { 0 };
+
+const uint64_t epoch = trace_now();
+
+// the buffer is created on the first event, naming a thread is free
+thread_local TraceBuffer *current_buffer = nullptr;
+thread_local const char *current_name = nullptr;
+
+TraceBuffer &
+thread_buffer()
+{
+    if (!current_buffer)
+    {
+        // buffers outlive their threads so a dump can still read them
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        buffers.push_back(std::make_unique<TraceBuffer>());
+        current_buffer = buffers.back().get();
+        current_buffer->tid = int(buffers.size());
+        current_buffer->name = current_name ? current_name
+                             : "thread " + std::to_string(current_buffer->tid);
+    }
+    return *current_buffer;
+}
+
+void
+write_escaped(std::ostream &out, const std::string &s)
+{
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            out << '\\';
+        out << c;
+    }
+}
+
+}
+
+void
+trace_event(const char *name, uint64_t start, uint64_t end)
+{
+    TraceBuffer &buffer = thread_buffer();
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    buffer.events[head % TraceBuffer::capacity] = TraceEvent { name, start, end };
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void
+trace_thread_name(const char *name)
+{
+    current_name = name;
+    if (current_buffer)
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        current_buffer->name = name;
+    }
+}
+
+void
+trace_frame()
+{
+    if (!trace_enabled.load(std::memory_order_relaxed))
+        return;
+    uint64_t now = trace_now();
+    uint64_t n = frame_count.load(std::memory_order_relaxed);
+    if (n > 0)
+        trace_event("frame", frame_starts[(n - 1) % frame_capacity], now);
+    frame_starts[n % frame_capacity] = now;
+    frame_count.store(n + 1, std::memory_order_release);
+}
+
+bool
+trace_dump(const std::string &path, int frames)
+{
+    std::ofstream out(path, std::ios::trunc);
+    if (!out)
+        return false;
+
+    uint64_t recorded = frame_count.load(std::memory_order_acquire);
+    uint64_t window = std::min<uint64_t>({ uint64_t(std::max(frames, 1)), recorded,
+                                           frame_capacity });
+    uint64_t from = window ? frame_starts[(recorded - window) % frame_capacity] : 0;
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    std::vector<TraceEvent> events;
+    for (auto &buffer : buffers)
+    {
+        out << (first ? "" : ",\n")
+            << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+            << buffer->tid << ",\"args\":{\"name\":\"";
+        write_escaped(out, buffer->name);
+        out << "\"}}";
+        first = false;
+
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t tail = head > TraceBuffer::capacity ? head - TraceBuffer::capacity : 0;
+        events.clear();
+        for (uint64_t i = tail; i < head; i++)
+            events.push_back(buffer->events[i % TraceBuffer::capacity]);
+
+        // the producer kept going while we copied, drop what it overwrote and
+        // the slot it may be writing now, which it fills before publishing
+        uint64_t now_head = buffer->head.load(std::memory_order_acquire);
+        size_t overwritten = now_head + 1 > TraceBuffer::capacity + tail
+                           ? std::min<size_t>(now_head + 1 - TraceBuffer::capacity - tail,
+                                              events.size())
+                           : 0;
+
+        for (size_t i = overwritten; i < events.size(); i++)
+        {
+            const TraceEvent &e = events[i];
+            if (e.start < from)
+                continue;
+            out << ",\n{\"name\":\"";
+            write_escaped(out, e.name);
+            out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+                << ",\"ts\":" << (e.start - epoch) / 1000.0
+                << ",\"dur\":" << (e.end - e.start) / 1000.0 << "}";
+        }
+    }
+    out << "\n]}\n";
+    return bool(out);
+}
@@ -0,0 +1,60 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Timeline recorder for chrome://tracing and Perfetto. Every thread writes
+// complete events into its own lock-free ring buffer; trace_dump() copies
+// them out. While disabled a scope costs one relaxed load.
+
+extern std::atomic<bool> trace_enabled;
+
+// steady_clock nanoseconds, the same clock the profiler uses
+inline uint64_t
+trace_now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// name has to outlive the trace, string literals are fine
+void
+trace_event(const char *name, uint64_t start, uint64_t end);
+
+void
+trace_thread_name(const char *name);
+
+// Marks the start of a frame; dumps cover whole frames
+void
+trace_frame();
+
+// Writes the events of the last `frames` frames as trace event JSON
+bool
+trace_dump(const std::string &path, int frames);
+
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name)
+        : name(name),
+          start(trace_enabled.load(std::memory_order_relaxed) ? trace_now() : 0) {}
+
+    ~TraceScope()
+    {
+        if (start != 0)
+            trace_event(name, start, trace_now());
+    }
+
+private:
+    const char *name;
+    uint64_t start;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+#endif // TRACE_HPP
@@ -0,0 +1,49 @@
+#ifndef TRIPLE_BUFFER_HPP
+#define TRIPLE_BUFFER_HPP
+
+#include <atomic>
+#include <cstdint>
+
+// Hands the latest value from one writer thread to one reader thread
+// without locks. The writer fills back() and publishes it, the reader picks
+// up the newest published value with update() and keeps reading front()
+// until its next update. Neither side ever waits for the other; values the
+// reader didn't get to in time are overwritten.
+//
+// Slots are reused, so a writer that assigns into back() keeps the
+// capacity of whatever was there two publishes ago.
+template <typename T>
+class TripleBuffer
+{
+public:
+    explicit TripleBuffer(const T &initial) : slots { initial, initial, initial } {}
+
+    // Writer side
+    T &back() { return slots[back_index]; }
+    void publish()
+    {
+        back_index = middle.exchange(back_index | fresh, std::memory_order_acq_rel) & index_mask;
+    }
+
+    // Reader side; true if a newer value was picked up
+    bool update()
+    {
+        if (!(middle.load(std::memory_order_relaxed) & fresh))
+            return false;
+        front_index = middle.exchange(front_index, std::memory_order_acq_rel) & index_mask;
+        return true;
+    }
+    const T &front() const { return slots[front_index]; }
+
+private:
+    static constexpr uint8_t index_mask = 3;
+    static constexpr uint8_t fresh = 4;
+
+    T slots[3];
+    // the writer and the reader touch their index on every call
+    alignas(64) uint8_t back_index = 0;
+    alignas(64) std::atomic<uint8_t> middle { 1 };
+    alignas(64) uint8_t front_index = 2;
+};
+
+#endif // TRIPLE_BUFFER_HPP
@@ -0,0 +1,193 @@
+#include "visibility.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+struct Coverage {
+    FrameVector<uint8_t> covered;
+    int left;
+};
+
+bool
+is_wall(const Board &board, int x, int y)
+{
+    return !board.contains(CellPos(x, y)) || board.at(x, y) != 0;
+}
+
+// Screen columns between the ends of a face, clipped to the near plane
+bool
+project_face(const ColumnBuffer &columns, Vector2 p0, Vector2 p1, int &x0, int &x1)
+{
+    const float near = 1e-3f;
+    Vector2 d0 = p0 - columns.origin;
+    Vector2 d1 = p1 - columns.origin;
+    float z0 = Vector2DotProduct(d0, columns.forward);
+    float z1 = Vector2DotProduct(d1, columns.forward);
+    float l0 = Vector2DotProduct(d0, columns.right);
+    float l1 = Vector2DotProduct(d1, columns.right);
+    if (z0 < near && z1 < near)
+        return false;
+    if (z0 < near)
+    {
+        float t = (near - z0) / (z1 - z0);
+        l0 += (l1 - l0) * t;
+        z0 = near;
+    }
+    else if (z1 < near)
+    {
+        float t = (near - z1) / (z0 - z1);
+        l1 += (l0 - l1) * t;
+        z1 = near;
+    }
+
+    float a = columns.project(l0, z0);
+    float b = columns.project(l1, z1);
+    if (a > b)
+        std::swap(a, b);
+    // column x sees the face when its ray, at x exactly, falls in [a, b)
+    x0 = int(std::max(std::ceil(a), 0.0f));
+    x1 = int(std::min(std::ceil(b), float(columns.count)));
+    return x0 < x1;
+}
+
+void
+add_face(const ColumnBuffer &columns, Coverage &coverage, CellPos cell, uint8_t face,
+         uint8_t tex_id, FrameVector<WallSegment> &segments)
+{
+    float x0 = float(cell.x * cell_size);
+    float y0 = float(cell.y * cell_size);
+    float x1 = x0 + cell_size;
+    float y1 = y0 + cell_size;
+    Vector2 p0, p1;
+    switch (face)
+    {
+    case FACE_WEST:  p0 = { x0, y0 }; p1 = { x0, y1 }; break;
+    case FACE_EAST:  p0 = { x1, y0 }; p1 = { x1, y1 }; break;
+    case FACE_NORTH: p0 = { x0, y0 }; p1 = { x1, y0 }; break;
+    default:         p0 = { x0, y1 }; p1 = { x1, y1 }; break;
+    }
+
+    int from, to;
+    if (!project_face(columns, p0, p1, from, to))
+        return;
+
+    // one segment per run of columns still open
+    for (int x = from; x < to;)
+    {
+        while (x < to && coverage.covered[x])
+            x++;
+        int start = x;
+        while (x < to && !coverage.covered[x])
+            coverage.covered[x++] = 1;
+        if (x > start)
+        {
+            segments.push_back(WallSegment { cell, face, tex_id, start, x });
+            coverage.left -= x - start;
+        }
+    }
+}
+
+void
+add_cell(const Board &board, const ColumnBuffer &columns, Coverage &coverage, CellPos cell,
+         FrameVector<WallSegment> &segments)
+{
+    if (!is_wall(board, cell.x, cell.y))
+        return;
+
+    // cull cells outside the view frustum, each as its bounding circle
+    const float radius = cell_size * 0.7072f;
+    Vector2 d = Vector2 { (cell.x + 0.5f) * cell_size, (cell.y + 0.5f) * cell_size } -
+                columns.origin;
+    float depth = Vector2DotProduct(d, columns.forward);
+    float lateral = std::abs(Vector2DotProduct(d, columns.right));
+    if (depth < -radius ||
+        lateral - depth * columns.plane_half >
+            radius * std::sqrt(1 + columns.plane_half * columns.plane_half))
+        return;
+
+    uint8_t tex_id = board.contains(cell) ? board.at(cell) : 0;
+    Vector2 o = columns.origin;
+    // faces turned to the camera, unless a wall hides them
+    if (o.x < cell.x * cell_size && !is_wall(board, cell.x - 1, cell.y))
+        add_face(columns, coverage, cell, FACE_WEST, tex_id, segments);
+    if (o.x > (cell.x + 1) * cell_size && !is_wall(board, cell.x + 1, cell.y))
+        add_face(columns, coverage, cell, FACE_EAST, tex_id, segments);
+    if (o.y < cell.y * cell_size && !is_wall(board, cell.x, cell.y - 1))
+        add_face(columns, coverage, cell, FACE_NORTH, tex_id, segments);
+    if (o.y > (cell.y + 1) * cell_size && !is_wall(board, cell.x, cell.y + 1))
+        add_face(columns, coverage, cell, FACE_SOUTH, tex_id, segments);
+}
+
+}
+
+void
+find_visible_walls(const Board &board, const ColumnBuffer &columns,
+                   FrameVector<WallSegment> &segments)
+{
+    segments.clear();
+    Coverage coverage { FrameVector<uint8_t>(columns.count, 0), columns.count };
+
+    // Only cells in [-1, width] x [-1, height] matter: the ring past the
+    // board edge walls it in.
+    CellPos center(get_cell(columns.origin));
+    int min_x = -1, max_x = board.width();
+    int min_y = -1, max_y = board.height();
+    int max_ring = std::max(std::abs(center.x - min_x), std::abs(center.x - max_x)) +
+                   std::max(std::abs(center.y - min_y), std::abs(center.y - max_y));
+
+    for (int ring = 1; ring <= max_ring && coverage.left > 0; ring++)
+    {
+        for (int dx = -ring; dx <= ring; dx++)
+        {
+            int x = center.x + dx;
+            if (x < min_x || x > max_x)
+                continue;
+            int dy = ring - std::abs(dx);
+            if (center.y - dy >= min_y && center.y - dy <= max_y)
+                add_cell(board, columns, coverage, CellPos(x, center.y - dy), segments);
+            if (dy != 0 && center.y + dy >= min_y && center.y + dy <= max_y)
+                add_cell(board, columns, coverage, CellPos(x, center.y + dy), segments);
+        }
+    }
+}
+
+void
+rasterize_walls(const FrameVector<WallSegment> &segments, ColumnBuffer &columns)
+{
+    for (const WallSegment &segment : segments)
+    {
+        bool horizontal = segment.face == FACE_NORTH || segment.face == FACE_SOUTH;
+        float line = float(cell_size) *
+                     (horizontal ? segment.cell.y + (segment.face == FACE_SOUTH)
+                                 : segment.cell.x + (segment.face == FACE_EAST));
+        for (int x = segment.x0; x < segment.x1; x++)
+        {
+            Vector2 ray = columns.forward + columns.right * columns.plane[x];
+            float t = horizontal ? (line - columns.origin.y) / ray.y
+                                 : (line - columns.origin.x) / ray.x;
+            columns.store(x, ray, columns.origin + ray * t, segment.cell, segment.face,
+                          segment.tex_id);
+        }
+    }
+}
+
+void
+extract_view(const Board &board, const Player &player, float fov, int columns_count,
+             ColumnBuffer &columns)
+{
+    columns.set_camera(player, fov, columns_count);
+    for (int x = 0; x < columns.count; x++)
+    {
+        // nothing in sight, the walls pass draws nothing
+        columns.ray_x[x] = columns.forward.x + columns.right.x * columns.plane[x];
+        columns.ray_y[x] = columns.forward.y + columns.right.y * columns.plane[x];
+        columns.perp_dist[x] = INFINITY;
+        columns.tex_id[x] = 0;
+    }
+
+    ArenaScope scope;
+    FrameVector<WallSegment> segments;
+    find_visible_walls(board, columns, segments);
+    rasterize_walls(segments, columns);
+}
@@ -0,0 +1,35 @@
+#ifndef VISIBILITY_HPP
+#define VISIBILITY_HPP
+
+#include "board.hpp"
+#include "frame_arena.hpp"
+#include "raycast.hpp"
+#include "world.hpp"
+
+// The visible part of one cell face: columns [x0, x1)
+struct WallSegment {
+    CellPos cell;
+    uint8_t face;
+    uint8_t tex_id;
+    int x0;
+    int x1;
+};
+
+// Walks the cells around the camera of `columns` ring by ring in Manhattan
+// distance. Along any ray that distance grows by one per cell, so the walk
+// is front to back and a face only keeps the columns no nearer face took.
+// Cells past the board edge count as walls with texture 0, like cast_ray.
+void
+find_visible_walls(const Board &board, const ColumnBuffer &columns,
+                   FrameVector<WallSegment> &segments);
+
+// Fills every column of a segment from the face's line, no ray casting
+void
+rasterize_walls(const FrameVector<WallSegment> &segments, ColumnBuffer &columns);
+
+// cast_view built on the two above
+void
+extract_view(const Board &board, const Player &player, float fov, int columns_count,
+             ColumnBuffer &columns);
+
+#endif // VISIBILITY_HPP
@@ -0,0 +1,90 @@
+#ifndef WORLD_HPP
+#define WORLD_HPP
+
+#include <raylib-ext.hpp>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+
+const int cell_size = 80;
+
+struct Player {
+    Vector2 pos;
+    float rotation;
+    float speed;
+};
+
+struct Object {
+    size_t id;
+    Vector2 pos;
+    Image image;
+
+    Object()
+    {
+        static size_t counter = 0;
+        id = counter++;
+    }
+};
+
+struct CellPos {
+    int x, y;
+    CellPos() : x(0), y(0) {};
+    CellPos(int x, int y) : x(x), y(y) {};
+    CellPos(Vector2 v) : x(int(v.x)), y(int(v.y)) {};
+    bool operator==(const CellPos &p) const
+    {
+        return p.x == x && p.y == y;
+    }
+    bool operator!=(const CellPos &p) const
+    {
+        return p.x != x || p.y != y;
+    }
+
+};
+
+inline std::ostream &operator<<(std::ostream &stream, const CellPos &c)
+{
+    stream << c.x << ' ' << c.y;
+    return stream;
+}
+
+struct hash_fn
+{
+    std::size_t operator() (const CellPos &p) const
+    {
+        std::size_t h1 = std::hash<int>()(p.x);
+        std::size_t h2 = std::hash<int>()(p.y);
+        return h1 ^ h2;
+    }
+};
+
+struct RayHit {
+    Vector2 pos;
+    CellPos cell_pos;
+    bool is_horizontal;
+};
+
+struct Collision {
+    Vector2 pos;
+    CellPos cell;
+};
+
+inline Vector2
+get_cell(const Vector2 &pos)
+{
+    return Vector2 {
+        std::floor(pos.x / cell_size),
+        std::floor(pos.y / cell_size),
+    };
+}
+
+inline float
+fix_angle(float angle)
+{
+    while (angle > PI)  angle -= 2 * PI;
+    while (angle < -PI) angle += 2 * PI;
+    return angle;
+}
+
+#endif // WORLD_HPP